@@ -3,11 +3,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <ctype.h>
 #include <math.h>
+#include <inttypes.h>
+#include <limits.h>
 //---
 #include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
 //---
 #include "vars.h" // compile time variables
 
@@ -43,8 +50,8 @@
 
 	================================================================================ */
 
-#include "xorenc.c"
-#include "xorenc_implementation.c"
+#include "xorenc.h" // libxorenc
+#include "main_server.c"
 #include "main_cmdline.c"
 
 /***************************************************/
@@ -52,23 +59,54 @@
 /***************************************************/
 // 'main' variables, constants and other data
 enum CmdOptions
-	{ Help=0, Version, License, StandardInput, StandardOutput, Key };
+	{ Help=0, Version, License, StandardInput, StandardOutput, Key, Serve, Workers, Queue, Client, Stats, StatsJSON, Trace, Progress, ProgressFD, MaxMemory, BWLimit, CPULimit, Idle, InPlace, Offset, Length, CyclicKey, PadPool, GenKey, KeyFD, KeyFormat, Checksum, Verify, Compress, SplitSize, KeyOffset, CPUs, NUMA, Follow, IOSize };
 
-#define MAIN_OPTION_COUNT 6
+#define MAIN_OPTION_COUNT 36
 
 char*          m_work_dir;
 int            m_param_count;
 TUserCmdLine*  m_user_cmd_line;
 TCmdLine       m_cmd_line[MAIN_OPTION_COUNT] = {
-                                                  {{ "--help",                   "-h",   "",        "Show help message.",                                              0, false }},
-                                                  {{ "--version",                "-v",   "",        "Show version info.",                                              0, false }},
-                                                  {{ "--license",                "-l",   "",        "Show license info.",                                              0, false }},
-                                                  {{ "--stdin",                  "-in",  "",        "Input file from standard input (stdin).",                         0, false }},
-                                                  {{ "--stdout",                 "-out", "",        "Output file to standard output (stdout).",                        0, false }},
-                                                  {{ "--key",                    "-k",   " <text>", "Input key as bytes (39 4B 8A...), common password, or key file.", 0, false }}
+                                                  {{ "--help",                   "-h",   "",             "Show help message.",                                                                                 0, false }},
+                                                  {{ "--version",                "-v",   "",             "Show version info.",                                                                                 0, false }},
+                                                  {{ "--license",                "-l",   "",             "Show license info.",                                                                                 0, false }},
+                                                  {{ "--stdin",                  "-in",  "",             "Input file from standard input (stdin).",                                                            0, false }},
+                                                  {{ "--stdout",                 "-out", "",             "Output file to standard output (stdout).",                                                           0, false }},
+                                                  {{ "--key",                    "-k",   " <text>",      "Input key as bytes (39 4B 8A...), common password, or key file.",                                    0, false }},
+                                                  {{ "--serve",                  "-S",   " <socket>",    "Run as daemon, processing jobs received on Unix socket.",                                            0, false }},
+                                                  {{ "--workers",                "-w",   " <count>",     "Number of jobs processed at the same time by daemon.",                                               0, false }},
+                                                  {{ "--queue",                  "-q",   " <count>",     "Number of jobs waiting for daemon worker (backpressure).",                                           0, false }},
+                                                  {{ "--client",                 "-c",   " <socket>",    "Send file to daemon listening on Unix socket.",                                                      0, false }},
+                                                  {{ "--stats",                  "-st",  "",             "Show time spent in each stage, throughput and resource usage at exit.",                              0, false }},
+                                                  {{ "--stats-json",             "-sj",  " <file>",      "Write statistics (see '--stats') as JSON to file.",                                                  0, false }},
+                                                  {{ "--trace",                  "-tr",  " <file>",      "Write Chrome trace events of every stage to file (see 'chrome://tracing').",                         0, false }},
+                                                  {{ "--progress",               "-pg",  "",             "Show progress (bytes done, throughput, KDF blocks per minute and ETA) every second.",                0, false }},
+                                                  {{ "--progress-fd",            "-pf",  " <fd>",        "Write progress (see '--progress') as machine-readable lines to file descriptor.",                    0, false }},
+                                                  {{ "--max-memory",             "-mm",  " <size>",      "Memory budget (e.g. 512M) for KDFs, workers and buffers (default: memory limit of cgroup).",         0, false }},
+                                                  {{ "--bwlimit",                "-bw",  " <size>",      "Limit reading and writing to size per second each (e.g. 20M).",                                      0, false }},
+                                                  {{ "--cpu-limit",              "-cl",  " <threads>",   "Maximum CPU threads used by KDFs (derived keys do not change).",                                     0, false }},
+                                                  {{ "--idle",                   "-id",  "",             "Run with idle CPU (SCHED_IDLE) and I/O priority, only using resources nobody else needs.",           0, false }},
+                                                  {{ "--in-place",               "-ip",  "",             "Overwrite input file instead of creating a new one (crash-safe, see README).",                       0, false }},
+                                                  {{ "--offset",                 "-of",  " <size>",      "Process only the range of input file starting at size (e.g. 4G).",                                   0, false }},
+                                                  {{ "--length",                 "-ln",  " <size>",      "Process only size bytes of input file (default: up to its end).",                                    0, false }},
+                                                  {{ "--cyclic-key",             "-ck",  "",             "Repeat direct key when shorter than the data (weak, only for legacy consumers).",                    0, false }},
+                                                  {{ "--pad-pool",               "-pp",  "",             "Use a new, never reused slice of key file (pad) per file, recorded in output header.",               0, false }},
+                                                  {{ "--genkey",                 "-gk",  " <size>",      "Generate random key file of size (e.g. 4G) for direct mode, path given last.",                       0, false }},
+                                                  {{ "--key-fd",                 "-kd",  " <fd>",        "Read direct key (of any size) from file descriptor, e.g. a pipe.",                                   0, false }},
+                                                  {{ "--key-format",             "-kfo", " <format>",    "Encoding of key files and of --key-fd: raw (default), hex or base64.",                               0, false }},
+                                                  {{ "--checksum",               "-cs",  "",             "Encrypt with CRC32C trailer of every block; input with a trailer is checked and decrypted.",         0, false }},
+                                                  {{ "--verify",                 "-vf",  "",             "Check trailer of file (see --checksum) by decrypting it, without writing anything.",                 0, false }},
+                                                  {{ "--compress",               "-cz",  " <algorithm>", "Compress before encrypting (zstd or lz4); compressed input is decrypted and decompressed.",          0, false }},
+                                                  {{ "--split-size",             "-sp",  " <size>",      "Write output as numbered parts of size (e.g. 64M): <file>.xen.000, .001...",                         0, false }},
+                                                  {{ "--key-offset",             "-ko",  " <size>",      "Start keystream at offset, e.g. to decrypt part N of --split-size output (N * size).",               0, false }},
+                                                  {{ "--cpus",                   "-cpu", " <list>",      "Run only on these CPUs, e.g. 0-15,32-47 (daemon workers are spread over them).",                     0, false }},
+                                                  {{ "--numa",                   "-nm",  "",             "Pin each daemon worker (or the process) to one NUMA node, keeping its memory there.",                0, false }},
+                                                  {{ "--follow",                 "-fl",  " <ms>",        "Keep processing data appended to input file, written within ms; ends on rename, removal or Ctrl+C.", 0, false }},
+                                                  {{ "--io-size",                "-io",  " <size>",      "Size of read/write requests (default adapts to file type and device, up to 16M).",                   0, false }}
                                                };
 // xorenc vars
 TXORencParams XORenc_params;
+TXORencStats  XORenc_stats;
 
 // loop exclusive variables
 size_t lp0, lp1;
@@ -154,6 +192,355 @@ int main(int argc, char* argv[]) {
 		return 0;
 	}
   
+	// write trace events of every stage?
+	if (m_cmd_line[Trace].Options.Given) {
+		XORenc_params.trace = m_TraceOpen(m_GetOptionParam(m_cmd_line[Trace], m_param_count, argv));
+	}
+
+	// memory budget, when not given the memory limit of cgroup is respected
+	m_max_memory = XORenc_memory_limit();
+
+	if (m_cmd_line[MaxMemory].Options.Given) {
+		m_max_memory = m_GetOptionSize(m_cmd_line[MaxMemory], m_param_count, argv);
+	}
+
+	// quality of service, for running next to latency sensitive services
+	if (m_cmd_line[BWLimit].Options.Given) {
+		XORenc_params.bwlimit = m_GetOptionSize(m_cmd_line[BWLimit], m_param_count, argv);
+	}
+
+	// size of read/write requests, when not given it adapts to each file
+	if (m_cmd_line[IOSize].Options.Given) {
+		XORenc_params.io_size = m_GetOptionSize(m_cmd_line[IOSize], m_param_count, argv);
+
+		if ((XORenc_params.io_size < 4096) || (XORenc_params.io_size > XORENC_IO_SIZE_MAX)) {
+			m_FatalError("Error: Size of read/write requests must be between 4K and 16M.");
+		}
+	}
+
+	if (m_cmd_line[CPULimit].Options.Given) {
+		XORenc_params.kdf_threads = m_GetOptionNumber(m_cmd_line[CPULimit], m_param_count, argv);
+
+		if (XORenc_params.kdf_threads < 1) {
+			m_FatalError("Error: CPU limit must be at least 1 thread.");
+		}
+	}
+
+	if (m_cmd_line[Idle].Options.Given) {
+		m_SetIdlePriority();
+	}
+
+	// CPU placement; threads started afterwards (KDFs, key generation, daemon workers) inherit it
+	if (m_cmd_line[CPUs].Options.Given) {
+		cpu_set_t cpus;
+
+		if (m_ParseCPUList(m_GetOptionParam(m_cmd_line[CPUs], m_param_count, argv), &cpus) < 1) {
+			m_FatalError("Error: CPU list must be like '0-15,32-47'.");
+		}
+
+		if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+			m_FatalError("Error: Could not run on given CPUs.");
+		}
+	}
+
+	m_numa = m_cmd_line[NUMA].Options.Given;
+
+	// generate key file?
+	if (m_cmd_line[GenKey].Options.Given) {
+		uint64_t size = m_GetOptionSize(m_cmd_line[GenKey], m_param_count, argv);
+		int      r;
+
+		if (m_cmd_line[GenKey].Options.Pos+1 >= m_param_count) {
+			m_FatalError("Error: Path of key file to generate not given.");
+		}
+
+		r = XORenc_generate_key(argv[m_param_count], size, XORenc_params.kdf_threads, XORenc_params);
+
+		if (r < 0) {
+			fprintf(stderr, "\nError (%d) occurred while generating key file: %s :(\n", r, XORenc_error_message(r));
+
+			return 1;
+		}
+
+		fprintf(stderr, "\nKey file: \"%s\" (%" PRIu64 " bytes) generated successfully! :)\n", argv[m_param_count], size);
+
+		return 0;
+	}
+
+	// check for daemon mode
+	if (m_cmd_line[Serve].Options.Given) {
+		unsigned long workers    = sysconf(_SC_NPROCESSORS_ONLN);
+		unsigned long queue_size = 64;
+		unsigned int  kdf_slots;
+
+		if (m_cmd_line[Workers].Options.Given) {
+			workers = m_GetOptionNumber(m_cmd_line[Workers], m_param_count, argv);
+		}
+
+		if (m_cmd_line[Queue].Options.Given) {
+			queue_size = m_GetOptionNumber(m_cmd_line[Queue], m_param_count, argv);
+		}
+
+		if ((workers < 1) || (queue_size < 1)) {
+			m_FatalError("Error: Number of workers and queue size must be at least 1.");
+		}
+
+		kdf_slots = m_ServerPlanMemory(m_max_memory, &workers);
+
+		if (kdf_slots == 0) {
+			m_FatalError("Error: Memory budget is lower than needed by a single derived job.");
+		}
+
+		// KDFs of all derived jobs together stay within CPU limit
+		if (XORenc_params.kdf_threads > 0) {
+			unsigned int job_threads = (XORenc_params.kdf_threads < XORenc_kdf_threads()) ? XORenc_params.kdf_threads : XORenc_kdf_threads();
+
+			if (kdf_slots > XORenc_params.kdf_threads / job_threads) {
+				kdf_slots = XORenc_params.kdf_threads / job_threads;
+			}
+		}
+
+		m_Serve(m_GetOptionParam(m_cmd_line[Serve], m_param_count, argv), workers, queue_size, kdf_slots, XORenc_params);
+
+		m_FatalError("Error: Daemon could not be started.");
+	}
+
+	// keep processing (and its memory) on one NUMA node, the one it runs on now
+	if (m_numa) {
+		TNumaNode    nodes[MAIN_MAX_NODES];
+		cpu_set_t    allowed;
+		unsigned int node_count = 0;
+		int          cpu        = sched_getcpu();
+
+		if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+			node_count = m_NumaTopology(&allowed, nodes, MAIN_MAX_NODES);
+		}
+
+		for (lp0=0; (lp0 < node_count) && ((cpu < 0) || (! CPU_ISSET(cpu, &nodes[lp0].cpus))); lp0++);
+
+		if (node_count > 0) {
+			m_NumaBind(&nodes[(lp0 < node_count) ? lp0 : 0]);
+		}
+	}
+
+	// send files to daemon instead of processing them here?
+	if (m_cmd_line[Client].Options.Given) {
+		m_client_socket = m_GetOptionParam(m_cmd_line[Client], m_param_count, argv);
+	}
+
+	// repeat short direct keys?
+	if (m_cmd_line[CyclicKey].Options.Given) {
+		XORenc_params.cyclic_key = true;
+	}
+
+	// encoding of key files
+	if (m_cmd_line[KeyFormat].Options.Given) {
+		const char* format = m_GetOptionParam(m_cmd_line[KeyFormat], m_param_count, argv);
+
+		if (strcmp(format, "raw") == 0) {
+			XORenc_params.key_format = XORENC_KEY_RAW;
+		}
+		else if (strcmp(format, "hex") == 0) {
+			XORenc_params.key_format = XORENC_KEY_HEX;
+		}
+		else if (strcmp(format, "base64") == 0) {
+			XORenc_params.key_format = XORENC_KEY_BASE64;
+		}
+		else {
+			m_FatalError("Error: Key format must be 'raw', 'hex' or 'base64'.");
+		}
+	}
+
+	// several direct keys? ('--key <key> <key>... <file>', all of them XOR'ed in one pass)
+	if (m_cmd_line[Key].Options.Given) {
+		size_t last = m_param_count - ((m_cmd_line[StandardInput].Options.Given) ? 0 : 1);
+
+		for (lp0 = m_cmd_line[Key].Options.Pos+2; (lp0 <= last) && (argv[lp0][0] != '-'); lp0++) {
+			if ((access(argv[lp0], R_OK) != 0) && (XORenc_key_is_byte_sequence(argv[lp0]) == false)) {
+				m_FatalError("Error: Every one of several keys must be a key file or a byte sequence.");
+			}
+
+			XORenc_params.extra_key_count += 1;
+		}
+
+		if (XORenc_params.extra_key_count > 0) {
+			XORenc_params.extra_keys = (const char**)&argv[m_cmd_line[Key].Options.Pos+2];
+
+			if (XORenc_params.extra_key_count >= XORENC_MAX_KEYS) {
+				m_FatalError("Error: Too many keys given.");
+			}
+
+			if ((access(argv[m_cmd_line[Key].Options.Pos+1], R_OK) != 0) && (XORenc_key_is_byte_sequence(argv[m_cmd_line[Key].Options.Pos+1]) == false)) {
+				m_FatalError("Error: Every one of several keys must be a key file or a byte sequence.");
+			}
+
+			if (m_client_socket != NULL) {
+				m_FatalError("Error: Several keys can not be sent to a daemon.");
+			}
+		}
+	}
+
+	// overwrite input file?
+	if (m_cmd_line[InPlace].Options.Given) {
+		if (m_cmd_line[StandardInput].Options.Given || m_cmd_line[StandardOutput].Options.Given || (m_client_socket != NULL)) {
+			m_FatalError("Error: In-place mode can not be used with standard input/output or a daemon.");
+		}
+
+		m_in_place = true;
+	}
+
+	// process only a range of input file?
+	if (m_cmd_line[Offset].Options.Given || m_cmd_line[Length].Options.Given) {
+		if (m_cmd_line[StandardInput].Options.Given || m_in_place || (m_client_socket != NULL)) {
+			m_FatalError("Error: Range can not be used with standard input, in-place mode or a daemon.");
+		}
+
+		if (m_cmd_line[Offset].Options.Given) {
+			m_range_offset = m_GetOptionSize(m_cmd_line[Offset], m_param_count, argv);
+		}
+
+		if (m_cmd_line[Length].Options.Given) {
+			m_range_length = m_GetOptionSize(m_cmd_line[Length], m_param_count, argv);
+
+			if (m_range_length < 1) {
+				m_FatalError("Error: Length of range must be at least 1 byte.");
+			}
+		}
+
+		m_range = true;
+	}
+
+	// use slices of one-time-pad pool?
+	if (m_cmd_line[PadPool].Options.Given) {
+		if (m_cmd_line[StandardInput].Options.Given || m_in_place || m_range || XORenc_params.cyclic_key || (XORenc_params.extra_key_count > 0) || (m_client_socket != NULL)) {
+			m_FatalError("Error: Pad pool can not be used with standard input, in-place mode, range, cyclic or several keys, or a daemon.");
+		}
+
+		if ((! m_cmd_line[Key].Options.Given) || (m_cmd_line[Key].Options.Pos >= m_param_count) || (access(argv[m_cmd_line[Key].Options.Pos+1], R_OK) != 0)) {
+			m_FatalError("Error: Pad pool needs a key file (the pad).");
+		}
+
+		m_pad_pool = true;
+	}
+
+	// checksum trailer?
+	if (m_cmd_line[Checksum].Options.Given || m_cmd_line[Verify].Options.Given) {
+		if (m_in_place || m_range || m_pad_pool || (m_client_socket != NULL)) {
+			m_FatalError("Error: Checksum can not be used with in-place mode, range, pad pool or a daemon.");
+		}
+
+		m_checksum = m_cmd_line[Checksum].Options.Given;
+		m_verify   = m_cmd_line[Verify].Options.Given;
+	}
+
+	// compress before encrypting? (compressed input is decrypted and decompressed instead)
+	if (m_cmd_line[Compress].Options.Given) {
+		const char* algo = m_GetOptionParam(m_cmd_line[Compress], m_param_count, argv);
+
+		if (m_in_place || m_range || m_pad_pool || m_checksum || m_verify || (m_client_socket != NULL)) {
+			m_FatalError("Error: Compression can not be used with in-place mode, range, pad pool, checksum or a daemon.");
+		}
+
+		if (strcmp(algo, "zstd") == 0) {
+			m_compress = XORENC_COMPRESS_ZSTD;
+		}
+		else if (strcmp(algo, "lz4") == 0) {
+			m_compress = XORENC_COMPRESS_LZ4;
+		}
+		else {
+			m_FatalError("Error: Compression must be 'zstd' or 'lz4'.");
+		}
+	}
+
+	// split output into parts?
+	if (m_cmd_line[SplitSize].Options.Given) {
+		if (m_cmd_line[StandardOutput].Options.Given || m_cmd_line[StandardInput].Options.Given || m_in_place || m_range || m_pad_pool || m_checksum || m_verify ||
+			(m_compress != XORENC_COMPRESS_NONE) || (m_client_socket != NULL)) {
+			m_FatalError("Error: Split output can not be used with standard input/output, in-place mode, range, pad pool, checksum, compression or a daemon.");
+		}
+
+		XORenc_params.split_size = m_GetOptionSize(m_cmd_line[SplitSize], m_param_count, argv);
+
+		if (XORenc_params.split_size < 1) {
+			m_FatalError("Error: Size of parts must be at least 1 byte.");
+		}
+	}
+
+	// start keystream at an offset? (a part of split output is decrypted on its own)
+	if (m_cmd_line[KeyOffset].Options.Given) {
+		if (m_cmd_line[StandardInput].Options.Given || m_in_place || m_range || m_pad_pool || m_checksum || m_verify ||
+			(m_compress != XORENC_COMPRESS_NONE) || (XORenc_params.split_size > 0) || (m_client_socket != NULL)) {
+			m_FatalError("Error: Key offset can not be used with standard input, in-place mode, range, pad pool, checksum, compression, split output or a daemon.");
+		}
+
+		m_key_offset = m_GetOptionSize(m_cmd_line[KeyOffset], m_param_count, argv);
+		m_part       = true;
+	}
+
+	// keep following input file as it grows?
+	if (m_cmd_line[Follow].Options.Given) {
+		if (m_cmd_line[StandardInput].Options.Given || m_in_place || m_range || m_pad_pool || m_checksum || m_verify || (m_compress != XORENC_COMPRESS_NONE) ||
+			(XORenc_params.split_size > 0) || m_part || (m_client_socket != NULL)) {
+			m_FatalError("Error: Follow mode can not be used with standard input, in-place mode, range, pad pool, checksum, compression, split output, key offset or a daemon.");
+		}
+
+		m_follow_latency = m_GetOptionNumber(m_cmd_line[Follow], m_param_count, argv);
+		m_follow         = true;
+
+		// timeout of 'poll' is an 'int'
+		if (m_follow_latency > INT_MAX) {
+			m_FatalError("Error: Option '--follow' takes at most 2147483647 milliseconds.");
+		}
+	}
+
+	// collect statistics?
+	if (m_cmd_line[Stats].Options.Given || m_cmd_line[StatsJSON].Options.Given) {
+		XORenc_params.stats = &XORenc_stats;
+
+		m_stats_show = m_cmd_line[Stats].Options.Given;
+
+		if (m_cmd_line[StatsJSON].Options.Given) {
+			m_stats_json = m_GetOptionParam(m_cmd_line[StatsJSON], m_param_count, argv);
+		}
+	}
+
+	// report progress? (it is based on statistics)
+	if (m_cmd_line[Progress].Options.Given || m_cmd_line[ProgressFD].Options.Given) {
+		XORenc_params.stats = &XORenc_stats;
+
+		m_progress_fd = STDERR_FILENO;
+
+		if (m_cmd_line[ProgressFD].Options.Given) {
+			m_progress_fd      = m_GetOptionNumber(m_cmd_line[ProgressFD], m_param_count, argv);
+			m_progress_machine = true;
+		}
+	}
+  
+	// key from file descriptor (read whole, so it may be of any size)
+	if (m_cmd_line[KeyFD].Options.Given) {
+		static char key_path[64];
+
+		if (m_cmd_line[Key].Options.Given || (m_client_socket != NULL)) {
+			m_FatalError("Error: Key from file descriptor can not be used with '--key' or a daemon.");
+		}
+
+		snprintf(key_path, sizeof(key_path), "/dev/fd/%lu", m_GetOptionNumber(m_cmd_line[KeyFD], m_param_count, argv));
+
+		XORenc_params.key_type = Direct;
+
+		if (m_cmd_line[StandardInput].Options.Given) {
+			m_ProcessFile(NULL, key_path, true, XORenc_params);
+		}
+		else if (m_cmd_line[KeyFD].Options.Pos+1 < m_param_count) {
+			m_ProcessFile(argv[m_param_count], key_path, m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+		}
+		else {
+			m_FatalError("Error: Input file not given or is not accessible.");
+		}
+
+		return 0;
+	}
+
 	// check for option #4
 	if (m_cmd_line[Key].Options.Given) {
 		// read option parameter, it must exist
@@ -168,7 +555,7 @@ int main(int argc, char* argv[]) {
 					// from regular file, to standard output
 					if (m_cmd_line[Key].Options.Pos+1 < m_param_count) {
 						// file is not from standard input and file was specified
-						XORenc_process_file(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+						m_ProcessFile(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
 					}
 					else {
 						// input file is missing from command line
@@ -177,12 +564,12 @@ int main(int argc, char* argv[]) {
 				}
 				else if (m_cmd_line[StandardInput].Options.Given == true) {
 					// from standard input, to standard output
-					XORenc_process_file(NULL, argv[m_cmd_line[Key].Options.Pos+1], true, XORenc_params);
+					m_ProcessFile(NULL, argv[m_cmd_line[Key].Options.Pos+1], true, XORenc_params);
 				}
 				else if ((m_cmd_line[StandardOutput].Options.Given == false) && (m_cmd_line[StandardInput].Options.Given == false)) {
 					// from regular file, to regular file
 					if (m_cmd_line[Key].Options.Pos+1 < m_param_count) {
-						XORenc_process_file(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+						m_ProcessFile(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
 					}
 					else {
 						// input file is missing from command line
@@ -200,7 +587,7 @@ int main(int argc, char* argv[]) {
 				if ((m_cmd_line[StandardOutput].Options.Given == true) && (m_cmd_line[StandardInput].Options.Given == false)) {
 					// from regular file, to standard output
 					if (m_cmd_line[Key].Options.Pos+1 < m_param_count) {
-						XORenc_process_file(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+						m_ProcessFile(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
 					}
 					else {
 						// input file is missing from command line
@@ -209,12 +596,12 @@ int main(int argc, char* argv[]) {
 				}
 				else if (m_cmd_line[StandardInput].Options.Given == true) {
 					// from standard input, to standard output
-					XORenc_process_file(NULL, argv[m_cmd_line[Key].Options.Pos+1], true, XORenc_params);
+					m_ProcessFile(NULL, argv[m_cmd_line[Key].Options.Pos+1], true, XORenc_params);
 				}
 				else if ((m_cmd_line[StandardOutput].Options.Given == false) && (m_cmd_line[StandardInput].Options.Given == false)) {
 					// from regular file, to regular file
 					if (m_cmd_line[Key].Options.Pos+1 < m_param_count) {
-						XORenc_process_file(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+						m_ProcessFile(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
 					}
 					else {
 						// input file is missing from command line
@@ -239,7 +626,7 @@ int main(int argc, char* argv[]) {
 				if ((m_cmd_line[StandardOutput].Options.Given == true) && (m_cmd_line[StandardInput].Options.Given == false)) {
 					// from regular file, to standard output
 					if (m_cmd_line[Key].Options.Pos+1 < m_param_count) {
-						XORenc_process_file(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+						m_ProcessFile(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
 					}
 					else {
 						// input file is missing from command line
@@ -248,12 +635,12 @@ int main(int argc, char* argv[]) {
 				}
 				else if (m_cmd_line[StandardInput].Options.Given == true) {
 					// from standard input, to standard output
-					XORenc_process_file(NULL, argv[m_cmd_line[Key].Options.Pos+1], true, XORenc_params);
+					m_ProcessFile(NULL, argv[m_cmd_line[Key].Options.Pos+1], true, XORenc_params);
 				}
 				else if ((m_cmd_line[StandardOutput].Options.Given == false) && (m_cmd_line[StandardInput].Options.Given == false)) {
 					// from regular file, to regular file
 					if (m_cmd_line[Key].Options.Pos+1 < m_param_count) {
-						XORenc_process_file(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
+						m_ProcessFile(argv[m_param_count], argv[m_cmd_line[Key].Options.Pos+1], m_cmd_line[StandardOutput].Options.Given, XORenc_params);
 					}
 					else {
 						// input file is missing from command line
@@ -77,6 +77,664 @@ void m_FatalError(const char* msg) {
 	exit(-5);
 }
 
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_show_tips:
+
+		Show security tips. :)
+
+	---------------------------------------------------------------------------------------- */
+void XORenc_show_tips() {
+
+	fprintf(stderr, "\nFor maximum security, make sure you follow the instructions below:\n\n");
+	
+	fprintf(stderr, "\t1.Never use the same key/password to encrypt different files.\n");
+	fprintf(stderr, "\t2.Always use random/unpredictable keys/passwords to encrypt files.\n");
+	fprintf(stderr, "\t3.When using direct encryption mode, make sure the key is (at least) as long as the data being encrypted.\n");
+}
+
+// statistics output, set by '--stats' (text to stderr) and '--stats-json' (JSON to file)
+bool        m_stats_show = false;
+const char* m_stats_json = NULL;
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ShowStats:
+
+		Show statistics of processing and resource usage of the process.
+
+	Parameters:
+
+		stats  -> Statistics filled by 'libxorenc'.
+
+		output -> Where to write statistics to.
+
+		json   -> Write as JSON (instead of text)?
+
+	---------------------------------------------------------------------------------------- */
+void m_ShowStats(const TXORencStats* stats, FILE* output, const bool json) {
+
+	struct rusage usage;
+	uint64_t      syscalls_read  = 0;
+	uint64_t      syscalls_write = 0;
+	uint64_t      stages_ns      = 0;
+	double        total_s        = stats->total_ns / 1e9;
+	double        throughput     = (total_s > 0) ? (stats->bytes_in / total_s) : 0;
+	char          line[128];
+	unsigned int  lpp0;
+	FILE*         fd0;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	// read/write system calls made by the process (Linux only)
+	fd0 = fopen("/proc/self/io", "r");
+
+	if (fd0 != NULL) {
+		while (fgets(line, sizeof(line), fd0) != NULL) {
+			sscanf(line, "syscr: %" SCNu64, &syscalls_read);
+			sscanf(line, "syscw: %" SCNu64, &syscalls_write);
+		}
+
+		fclose(fd0);
+	}
+
+	for (lpp0=0; lpp0 < XORENC_STAGE_COUNT; lpp0++) {
+		stages_ns += stats->time_ns[lpp0];
+	}
+
+
+	if (json) {
+		fprintf(output, "{\"total_seconds\": %.9f, \"bytes_in\": %" PRIu64 ", \"bytes_out\": %" PRIu64 ", \"bytes_per_second\": %.0f, ",
+				total_s, stats->bytes_in, stats->bytes_out, throughput);
+		fprintf(output, "\"blocks\": %" PRIu64 ", \"derived_blocks\": %" PRIu64 ", \"stages\": {", stats->blocks, stats->derived_blocks);
+
+		for (lpp0=0; lpp0 < XORENC_STAGE_COUNT; lpp0++) {
+			fprintf(output, "%s\"%s\": {\"seconds\": %.9f, \"share\": %.6f, \"calls\": %" PRIu64 "}",
+					(lpp0 > 0) ? ", " : "",
+					XORenc_stage_name(lpp0),
+					stats->time_ns[lpp0] / 1e9,
+					(stats->total_ns > 0) ? ((double)stats->time_ns[lpp0] / stats->total_ns) : 0,
+					stats->calls[lpp0]);
+		}
+
+		fprintf(output, "}, \"peak_rss_bytes\": %ld, \"syscalls\": {\"read\": %" PRIu64 ", \"write\": %" PRIu64 "}, ",
+				usage.ru_maxrss * 1024, syscalls_read, syscalls_write);
+		fprintf(output, "\"context_switches\": {\"voluntary\": %ld, \"involuntary\": %ld}}\n", usage.ru_nvcsw, usage.ru_nivcsw);
+	}
+	else {
+		fprintf(output, "\n");
+		fprintf(output, "Statistics:\n");
+		fprintf(output, "-----------\n");
+		fprintf(output, "\tTotal time:       %.3f s\n", total_s);
+		fprintf(output, "\tData:             %" PRIu64 " bytes in, %" PRIu64 " bytes out (%.2f MiB/s)\n", stats->bytes_in, stats->bytes_out, throughput / (1024 * 1024));
+		fprintf(output, "\tBlocks:           %" PRIu64 " (derived key blocks: %" PRIu64 ")\n", stats->blocks, stats->derived_blocks);
+		fprintf(output, "\n\t%-10s %12s %8s %8s\n", "Stage", "Time (s)", "Share", "Calls");
+
+		for (lpp0=0; lpp0 < XORENC_STAGE_COUNT; lpp0++) {
+			fprintf(output, "\t%-10s %12.6f %7.2f%% %8" PRIu64 "\n",
+					XORenc_stage_name(lpp0),
+					stats->time_ns[lpp0] / 1e9,
+					(stats->total_ns > 0) ? (100.0 * stats->time_ns[lpp0] / stats->total_ns) : 0,
+					stats->calls[lpp0]);
+		}
+
+		fprintf(output, "\t%-10s %12.6f %7.2f%%\n",
+				"other",
+				(stats->total_ns > stages_ns) ? ((stats->total_ns - stages_ns) / 1e9) : 0,
+				(stats->total_ns > stages_ns) ? (100.0 * (stats->total_ns - stages_ns) / stats->total_ns) : 0);
+
+		fprintf(output, "\n");
+		fprintf(output, "\tPeak RSS:         %.1f MiB\n", usage.ru_maxrss / 1024.0);
+		fprintf(output, "\tSystem calls:     %" PRIu64 " read, %" PRIu64 " write\n", syscalls_read, syscalls_write);
+		fprintf(output, "\tContext switches: %ld voluntary, %ld involuntary\n", usage.ru_nvcsw, usage.ru_nivcsw);
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_TraceOpen:
+
+		Create file for Chrome trace events (JSON array format), see 'TXORencParams.trace'.
+		(Option: --trace, -tr)
+
+	---------------------------------------------------------------------------------------- */
+FILE* m_TraceOpen(const char* filename) {
+
+	FILE* RESULT = fopen(filename, "w");
+
+	if (RESULT == NULL) {
+		m_FatalError("Error: Could not create trace file.");
+	}
+
+	// events are written as they happen, even if process never exits (daemon)
+	setvbuf(RESULT, NULL, _IOLBF, 0);
+
+	fprintf(RESULT, "[\n");
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_TraceClose:
+
+		Finish and close file of Chrome trace events.
+
+	---------------------------------------------------------------------------------------- */
+void m_TraceClose(FILE* trace) {
+
+	fprintf(trace, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"xorenc\"}}\n]\n", (int)getpid());
+
+	fclose(trace);
+}
+
+// memory budget (in bytes, 0 if unlimited), set by '--max-memory' or memory limit of cgroup
+size_t m_max_memory = 0;
+
+// overwrite input file (with a journal), set by '--in-place'
+bool m_in_place = false;
+
+// range of input file to process, set by '--offset' and '--length' (0 means up to its end)
+bool     m_range        = false;
+uint64_t m_range_offset = 0;
+uint64_t m_range_length = 0;
+
+// en/de-crypt with a slice of one-time-pad pool (key file), set by '--pad-pool'
+bool m_pad_pool = false;
+
+// checksum trailer, set by '--checksum' (write and check it) and '--verify' (only check it)
+bool m_checksum = false;
+bool m_verify   = false;
+
+// compression before encryption, set by '--compress'
+TXORencCompression m_compress = XORENC_COMPRESS_NONE;
+
+// keystream position of input (e.g. a part of split output), set by '--key-offset'
+bool     m_part       = false;
+uint64_t m_key_offset = 0;
+
+// follow input file as it grows, set by '--follow' (longest time data waits before it is written, in milliseconds)
+bool     m_follow         = false;
+uint64_t m_follow_latency = 0;
+
+// progress reporting, set by '--progress' (text to stderr) and '--progress-fd' (machine-readable lines)
+int  m_progress_fd      = -1;
+bool m_progress_machine = false;
+
+typedef struct {
+	pthread_mutex_t     lock;
+	pthread_cond_t      done;
+	bool                stopped;
+	pthread_t           thread;
+	const TXORencStats* stats;  // statistics filled by 'libxorenc' while processing
+	uint64_t            total;  // size of input (0 if unknown, e.g. pipe)
+	uint64_t            start;  // when processing started (see 'XORenc_clock')
+} TProgress;
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ShowProgress:
+
+		Write one progress report.
+
+	Parameters:
+
+		progress -> Progress of processing.
+
+		rate     -> Current throughput (in bytes/sec).
+
+		stalled  -> Seconds since last block was done.
+
+		last     -> Is it the final report?
+
+	---------------------------------------------------------------------------------------- */
+void m_ShowProgress(const TProgress* progress, const double rate, const double stalled, const bool last) {
+
+	uint64_t done     = __atomic_load_n(&progress->stats->bytes_in, __ATOMIC_RELAXED);
+	uint64_t derived  = __atomic_load_n(&progress->stats->derived_blocks, __ATOMIC_RELAXED);
+	double   elapsed  = (XORenc_clock() - progress->start) / 1e9;
+	double   kdf_rate = (elapsed > 0) ? (derived * 60 / elapsed) : 0;
+	double   eta      = -1;
+
+	if ((progress->total > 0) && (done > 0)) {
+		// based on average throughput, derived blocks make it too uneven otherwise
+		eta = (progress->total > done) ? ((progress->total - done) * elapsed / done) : 0;
+	}
+
+	if (m_progress_machine) {
+		dprintf(m_progress_fd, "%s bytes=%" PRIu64 " total=%" PRId64 " elapsed=%.1f rate=%.0f kdf_blocks_per_min=%.1f eta=%.0f stalled=%.1f\n",
+				last ? "done" : "progress", done, (progress->total > 0) ? (int64_t)progress->total : -1, elapsed, rate, kdf_rate, eta, stalled);
+
+		return;
+	}
+
+	dprintf(m_progress_fd, "\rProgress: %.1f MiB", done / (1024.0 * 1024));
+
+	if (progress->total > 0) {
+		dprintf(m_progress_fd, " / %.1f MiB (%.1f%%)", progress->total / (1024.0 * 1024), 100.0 * done / progress->total);
+	}
+
+	dprintf(m_progress_fd, ", %.2f MiB/s, %.1f KDF blocks/min", rate / (1024 * 1024), kdf_rate);
+
+	if (eta >= 0) {
+		dprintf(m_progress_fd, ", ETA %02u:%02u:%02u   ", (unsigned int)(eta / 3600), (unsigned int)fmod(eta / 60, 60), (unsigned int)fmod(eta, 60));
+	}
+	else {
+		dprintf(m_progress_fd, "   ");
+	}
+
+	if (last) {
+		dprintf(m_progress_fd, "\n");
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ProgressThread:
+
+		Report progress once a second until stopped. Processing itself only updates counters
+		of 'TXORencStats' once per block, so reporting costs nothing per byte.
+
+	---------------------------------------------------------------------------------------- */
+void* m_ProgressThread(void* arg) {
+
+	TProgress*      progress  = arg;
+	uint64_t        last_done = 0;
+	uint64_t        last_time = progress->start;
+	uint64_t        last_move = progress->start;
+	double          rate      = 0;
+	struct timespec wake;
+
+	clock_gettime(CLOCK_MONOTONIC, &wake);
+
+	pthread_mutex_lock(&progress->lock);
+
+	while (! progress->stopped) {
+		wake.tv_sec += 1;
+
+		if (pthread_cond_timedwait(&progress->done, &progress->lock, &wake) != ETIMEDOUT) {
+			continue;
+		}
+
+		uint64_t now  = XORenc_clock();
+		uint64_t done = __atomic_load_n(&progress->stats->bytes_in, __ATOMIC_RELAXED);
+
+		// current throughput, smoothed since blocks finish in bursts
+		rate = (0.7 * rate) + (0.3 * ((done - last_done) * 1e9 / (now - last_time)));
+
+		if (done != last_done) {
+			last_move = now;
+		}
+
+		last_done = done;
+		last_time = now;
+
+		m_ShowProgress(progress, rate, (now - last_move) / 1e9, false);
+	}
+
+	pthread_mutex_unlock(&progress->lock);
+
+	m_ShowProgress(progress, rate, 0, true);
+
+	return NULL;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ProgressStart:
+
+		Start reporting progress of processing file. (Options: --progress, -pg; --progress-fd, -pf)
+
+	Parameters:
+
+		progress -> Progress to be initialized.
+
+		filename -> Path to file being processed (if NULL, data is from standard input).
+
+		stats    -> Statistics filled while processing.
+
+	Return value:
+
+		Returns 0 if successful (progress must then be given to 'm_ProgressStop').
+
+	---------------------------------------------------------------------------------------- */
+int m_ProgressStart(TProgress* progress, const char* filename, const TXORencStats* stats) {
+
+	pthread_condattr_t attr;
+	struct stat        file_stat;
+
+	memset(progress, 0, sizeof(*progress));
+
+	progress->stats = stats;
+	progress->start = XORenc_clock();
+
+	// size is only known for regular files (standard input may be redirected from one)
+	if (((filename != NULL) ? stat(filename, &file_stat) : fstat(STDIN_FILENO, &file_stat)) == 0) {
+		progress->total = S_ISREG(file_stat.st_mode) ? file_stat.st_size : 0;
+	}
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&progress->lock, NULL);
+	pthread_cond_init(&progress->done, &attr);
+	pthread_condattr_destroy(&attr);
+
+	return pthread_create(&progress->thread, NULL, m_ProgressThread, progress);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ProgressStop:
+
+		Stop reporting progress, writing the final report.
+
+	---------------------------------------------------------------------------------------- */
+void m_ProgressStop(TProgress* progress) {
+
+	pthread_mutex_lock(&progress->lock);
+
+	progress->stopped = true;
+
+	pthread_cond_signal(&progress->done);
+	pthread_mutex_unlock(&progress->lock);
+
+	pthread_join(progress->thread, NULL);
+
+	pthread_cond_destroy(&progress->done);
+	pthread_mutex_destroy(&progress->lock);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_SetIdlePriority:
+
+		Run process with idle CPU scheduling (SCHED_IDLE) and idle I/O priority, so it only
+		gets CPU time and disk access nobody else needs. Threads created afterwards (KDFs,
+		daemon workers) inherit both. (Option: --idle, -id)
+
+	---------------------------------------------------------------------------------------- */
+void m_SetIdlePriority() {
+
+	struct sched_param param;
+
+	memset(&param, 0, sizeof(param));
+
+	if (sched_setscheduler(0, SCHED_IDLE, &param) != 0) {
+		fprintf(stderr, "\nWarning: Could not set idle CPU scheduling.\n");
+	}
+
+	// IOPRIO_WHO_PROCESS, IOPRIO_CLASS_IDLE (no glibc wrapper)
+	if (syscall(SYS_ioprio_set, 1, 0, 3 << 13) != 0) {
+		fprintf(stderr, "\nWarning: Could not set idle I/O priority.\n");
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_OpenOutput:
+
+		Open standard output or create a new '<filename>.xen' file (an existing file is not
+		overwritten, as with whole files).
+
+	Return value:
+
+		Returns file descriptor, or a negative value on failure.
+
+	---------------------------------------------------------------------------------------- */
+int m_OpenOutput(const char* filename, const bool std_out) {
+
+	char* out_filename;
+	int   RESULT;
+
+	if (std_out) {
+		return STDOUT_FILENO;
+	}
+
+	out_filename = (filename != NULL) ? malloc(strlen(filename) + sizeof(".xen")) : NULL;
+
+	if (out_filename == NULL) {
+		return -1;
+	}
+
+	sprintf(out_filename, "%s.xen", filename);
+
+	RESULT = open(out_filename, O_WRONLY | O_CREAT | O_EXCL, 0666);
+
+	free(out_filename);
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ProcessDescriptors:
+
+		Process input file (or standard input, if 'filename' is NULL) by file descriptors: only
+		the range given by '--offset' and '--length', with a slice of pad ('--pad-pool'), with
+		a checksum trailer ('--checksum', '--verify'), compressed ('--compress') or from a
+		keystream offset ('--key-offset'). Output is written to standard output or to a new
+		'.xen' file (nothing is written when verifying).
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int m_ProcessDescriptors(const char* filename, const char* key, const bool std_out, const TXORencParams params) {
+
+	int fd0, fd1;
+	int r;
+
+	fd0 = (filename != NULL) ? open(filename, O_RDONLY) : STDIN_FILENO;
+
+	if (fd0 < 0) {
+		return XORENC_ERROR_INPUT;
+	}
+
+	fd1 = (m_verify) ? -1 : m_OpenOutput(filename, std_out);
+
+	if ((fd1 < 0) && (! m_verify)) {
+		close(fd0);
+
+		return XORENC_ERROR_OUTPUT;
+	}
+
+	if ((m_verify) || (m_checksum)) {
+		// input with a trailer is checked and decrypted, any other is encrypted and gets one
+		r = XORenc_encrypt_checked(fd0, fd1, key, (! m_verify) && (! XORenc_is_checked(fd0)), params);
+	}
+	else if (m_compress != XORENC_COMPRESS_NONE) {
+		r = XORenc_encrypt_compressed(fd0, fd1, key, m_compress, params);
+	}
+	else if (m_part) {
+		r = XORenc_encrypt_part(fd0, fd1, key, m_key_offset, params);
+	}
+	else if (m_pad_pool) {
+		r = XORenc_encrypt_pad(fd0, fd1, key, params);
+	}
+	else {
+		r = XORenc_encrypt_range(fd0, fd1, key, m_range_offset, m_range_length, params);
+	}
+
+	if (fd0 != STDIN_FILENO) {
+		close(fd0);
+	}
+
+	if ((fd1 >= 0) && (fd1 != STDOUT_FILENO) && (close(fd1) != 0) && (r >= 0)) {
+		r = XORENC_ERROR_OUTPUT;
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ProcessFollow:
+
+		Process input file as it grows, until it is renamed or removed, or until SIGINT or
+		SIGTERM is received (data already appended is processed first). Output is written to
+		standard output or to a new '.xen' file.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int m_ProcessFollow(const char* filename, const char* key, const bool std_out, const TXORencParams params) {
+
+	sigset_t signals;
+	int      fd1, fd2;
+	int      r;
+
+	fd1 = m_OpenOutput(filename, std_out);
+
+	if (fd1 < 0) {
+		return XORENC_ERROR_OUTPUT;
+	}
+
+	// signals end following through a descriptor, so nothing is lost on Ctrl+C
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	fd2 = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+
+	r = XORenc_encrypt_follow(filename, fd1, key, m_follow_latency, fd2, params);
+
+	if (fd2 >= 0) {
+		struct signalfd_siginfo info;
+
+		// consume signal that ended following, it was handled
+		while (read(fd2, &info, sizeof(info)) == sizeof(info));
+
+		close(fd2);
+	}
+
+	pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+
+	if ((fd1 != STDOUT_FILENO) && (close(fd1) != 0) && (r >= 0)) {
+		r = XORENC_ERROR_OUTPUT;
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ProcessFile:
+
+		Process input file with 'libxorenc' (or with daemon, if '--client' was given) and report the result.
+
+	Parameters:
+
+		filename -> Path to file to be encrypted. Must be NULL if input is to be read from standard input (stdin).
+
+		key      -> Corresponds to key in one of the three available formats: path to file, byte sequence, or common string.
+
+		std_out  -> Output file to standard output (stdout)?
+
+		params   -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int m_ProcessFile(const char* filename, const char* key, const bool std_out, const TXORencParams params) {
+
+	TProgress progress;
+	bool      progress_shown = false;
+	size_t    derived_memory = XORenc_memory_derived() + XORenc_memory_footprint(XORENC_STAGE_READ) + XORenc_memory_footprint(XORENC_STAGE_KEY_LOAD); // derived blocks + I/O buffer + block buffer
+	int       r;
+
+	if (m_client_socket != NULL) {
+		// let daemon do it
+		r = m_ClientProcessFile(m_client_socket, filename, key, std_out, params);
+	}
+	else if ((params.key_type == Derived) && (m_max_memory > 0) && (m_max_memory < derived_memory)) {
+		// derived blocks can not be made smaller without changing the keystream
+		fprintf(stderr, "\nError: Memory budget (%zu MiB) is lower than needed by derived keys (%zu MiB).\n",
+				m_max_memory >> 20, derived_memory >> 20);
+
+		r = XORENC_ERROR_MEMORY;
+	}
+	else {
+		if ((m_progress_fd >= 0) && (params.stats != NULL)) {
+			progress_shown = (m_ProgressStart(&progress, filename, params.stats) == 0);
+		}
+
+		if (m_in_place) {
+			r = XORenc_encrypt_in_place(filename, key, params);
+		}
+		else if (m_follow) {
+			r = m_ProcessFollow(filename, key, std_out, params);
+		}
+		else if ((m_range) || (m_pad_pool) || (m_checksum) || (m_verify) || (m_compress != XORENC_COMPRESS_NONE) || (m_part)) {
+			r = m_ProcessDescriptors(filename, key, std_out, params);
+		}
+		else {
+			r = XORenc_process_file(filename, key, std_out, params);
+		}
+
+		if (progress_shown) {
+			m_ProgressStop(&progress);
+		}
+	}
+
+	if ((r >= 0) && (m_verify)) {
+		// nothing was written
+		fprintf(stderr, "\nFile: \"%s\" verified successfully, every checksum matches! :)\n", (filename != NULL) ? filename : "(stdin)");
+	}
+	else if ((r >= 0) && (filename != NULL)) {
+		// input was from regular file
+		fprintf(stderr, "\nFile: \"%s\" en/de-crypted successfully! :)\n", filename);
+		
+		XORenc_show_tips();
+	}
+	else if ((r >= 0) && (filename == NULL)) {
+		// input was from standard input (stdin)
+		fprintf(stderr, "\nFile en/de-crypted successfully! :)\n");
+		
+		XORenc_show_tips();
+	}
+	else if (r < 0) {
+		fprintf(stderr, "\nError (%d) occurred while processing file: %s :(\n", r, XORenc_error_message(r));
+	}
+
+	if (params.stats != NULL) {
+		if (m_stats_show) {
+			m_ShowStats(params.stats, stderr, false);
+		}
+
+		if (m_stats_json != NULL) {
+			FILE* fd0 = fopen(m_stats_json, "w");
+
+			if (fd0 != NULL) {
+				m_ShowStats(params.stats, fd0, true);
+
+				fclose(fd0);
+			}
+			else {
+				fprintf(stderr, "\nError: Could not write statistics to \"%s\".\n", m_stats_json);
+			}
+		}
+	}
+
+	if (params.trace != NULL) {
+		m_TraceClose(params.trace);
+	}
+
+	if ((m_verify) && (r < 0)) {
+		// result of verification is the exit status
+		exit(1);
+	}
+
+
+	return r;
+}
+
 /** ----------------------------------------------------------------------------------------
 
 	m_ShowHeader:
@@ -421,28 +1079,129 @@ TUserCmdLine* m_GetUserOptions(const unsigned int param_count, char* argv[]) {
 		}
 
 
-		const unsigned int BUFFER_SIZE = 4096;
-
 		unsigned int pl0 = 0;
 
 		while (pl0 < param_count) {
-			output->Options[pl0] = calloc(1, BUFFER_SIZE);
+			// copied whole, so arguments (e.g. long byte sequence keys) have no size limit
+			output->Options[pl0] = strdup(argv[pl0+1]);
 
 			if (output->Options[pl0] == NULL) {
 				m_FatalError("Could not allocate memory. (0x3dd852c0c52e85e0)");
 			}
 
-
-			if (strlen(argv[pl0+1]) < BUFFER_SIZE) { // BUFFER_SIZE + 1 NULL char.
-				strcpy(output->Options[pl0], argv[pl0+1]);
-			}
-			else {
-				m_FatalError("String is too large. Consider increasing buffer size. (0xc57820f02e24e5d0)");
-			}
-
 			pl0++;
 		}
 	}
 
 	return output;
 }
+
+/** ----------------------------------------------------------------------------------------
+
+	m_GetOptionParam:
+
+		Returns the parameter given to an option (the next item in command line).
+		Generates a fatal error if it is missing.
+
+	Parameters:
+
+		option      -> The option, as set by 'm_SetOptionsPos'.
+
+		param_count -> The total count of parameters given by the user.
+
+		argv        -> Pointer to user's given options string list.
+
+	---------------------------------------------------------------------------------------- */
+char* m_GetOptionParam(const TCmdLine option, const unsigned int param_count, char* argv[]) {
+
+	if ((option.Options.Pos < 1) || (option.Options.Pos >= param_count)) {
+		char* err_msg = calloc(1, 384);
+
+		if (err_msg == NULL) {
+			m_FatalError("Could not allocate memory. (0x5c1b3e0d7a4f2960)");
+		}
+
+		snprintf(err_msg, 384, "Error: Option '%s' requires a parameter.", option.Options.Long);
+
+		m_FatalError(err_msg);
+	}
+
+	return argv[option.Options.Pos+1];
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_GetOptionNumber:
+
+		Returns the parameter given to an option as a number.
+		Generates a fatal error if it is missing or is not a number.
+
+	---------------------------------------------------------------------------------------- */
+unsigned long m_GetOptionNumber(const TCmdLine option, const unsigned int param_count, char* argv[]) {
+
+	char*         param = m_GetOptionParam(option, param_count, argv);
+	char*         end;
+	unsigned long RESULT;
+
+	RESULT = strtoul(param, &end, 10);
+
+	if ((end == param) || (*end != '\0')) {
+		char* err_msg = calloc(1, 384);
+
+		if (err_msg == NULL) {
+			m_FatalError("Could not allocate memory. (0xa3e97f5120c84b10)");
+		}
+
+		snprintf(err_msg, 384, "Error: Option '%s' requires a number.", option.Options.Long);
+
+		m_FatalError(err_msg);
+	}
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_GetOptionSize:
+
+		Returns the parameter given to an option as a size in bytes; it may end with one of
+		the (binary) suffixes 'K', 'M', 'G' or 'T' (e.g. '512M').
+		Generates a fatal error if it is missing, is not a size, or does not fit in 'size_t'
+		('strtoull' would take '-1' as the largest value).
+
+	---------------------------------------------------------------------------------------- */
+size_t m_GetOptionSize(const TCmdLine option, const unsigned int param_count, char* argv[]) {
+
+	const char* SUFFIXES = "KMGT";
+	char*       param    = m_GetOptionParam(option, param_count, argv);
+	bool        valid    = (isdigit((unsigned char)param[0]) != 0); // no sign or leading space
+	char*       suffix;
+	char*       end;
+	size_t      RESULT;
+
+	errno  = 0;
+	RESULT = strtoull(param, &end, 10);
+	valid  = (valid) && (errno != ERANGE);
+
+	if ((valid) && (*end != '\0') && (end[1] == '\0') && ((suffix = strchr(SUFFIXES, toupper(*end))) != NULL)) {
+		unsigned int shift = 10 * (suffix - SUFFIXES + 1);
+
+		valid    = (RESULT <= (SIZE_MAX >> shift));
+		RESULT <<= shift;
+		end     += 1;
+	}
+
+	if ((! valid) || (*end != '\0')) {
+		char* err_msg = calloc(1, 384);
+
+		if (err_msg == NULL) {
+			m_FatalError("Could not allocate memory. (0x5d0c2e41b7a39f86)");
+		}
+
+		snprintf(err_msg, 384, "Error: Option '%s' requires a size (e.g. 512M).", option.Options.Long);
+
+		m_FatalError(err_msg);
+	}
+
+	return RESULT;
+}
@@ -0,0 +1,965 @@
+// Warning: Best read if using a monospaced/fixed-width font and tab width of 4.
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/** ================================================================================
+
+	This file is part of 'XORenc'.
+
+	'XORenc' is a "XOR-based" data encryption tool.
+
+
+	License:
+
+	The MIT License (MIT)
+
+	Copyright (c) 2019 Renan Souza da Motta <renansouzadamotta@yahoo.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	================================================================================ */
+
+/** ----------------------------------------------------------------
+
+	Daemon mode ('--serve') and its client ('--client').
+
+	One job per connection. The request is a list of null terminated
+	fields, passed with descriptors of input and output (and of the
+	key file, if any) attached (SCM_RIGHTS):
+
+		"fd" <key type> <key>
+
+	Where <key type> is "direct", "direct-cyclic" (direct key repeated
+	when shorter than the data) or "derived", and <key> is a password,
+	a byte sequence, or empty when the key file is attached. The daemon
+	never opens a path given by a client, so every file is accessed
+	with the permissions of the client. The reply is the result code
+	of the job as text, followed by a new line.
+
+	Requests are read by workers, a client that does not send its
+	request within 'SERVER_REQUEST_TIMEOUT' is dropped.
+
+	---------------------------------------------------------------- */
+#define SERVER_REQUEST_SIZE    16384 // maximum size of a request (in bytes)
+#define SERVER_REQUEST_TIMEOUT 10    // time to send a request (in seconds)
+
+/** ----------------------------------------------------------------
+
+	CPU placement ('--cpus' and '--numa').
+
+	NUMA topology is read from sysfs ('/sys/devices/system/node'),
+	so libnuma is not needed; without it all CPUs are one node.
+	Memory stays local by pinning a thread to the CPUs of its node
+	and making that node its preferred one: pages are placed when
+	first touched, by the thread or by the KDF threads it starts
+	(new threads inherit both).
+
+	---------------------------------------------------------------- */
+#define MAIN_MAX_NODES 64
+
+typedef struct {
+	unsigned int id;   // number of node (as in sysfs)
+	cpu_set_t    cpus; // CPUs of node that may be used
+} TNumaNode;
+
+// pin every daemon worker (or the process) to one NUMA node, set by '--numa'
+bool m_numa = false;
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ParseCPUList:
+
+		Parse a CPU list as used by sysfs and 'taskset -c' (e.g. "0-15,32-47").
+
+	Return value:
+
+		Returns number of CPUs in list, or a negative value if it is not valid.
+
+	---------------------------------------------------------------------------------------- */
+int m_ParseCPUList(const char* list, cpu_set_t* cpus) {
+
+	const char* p = list;
+
+	CPU_ZERO(cpus);
+
+	while ((*p != '\0') && (*p != '\n')) {
+		char*         end;
+		unsigned long first, last;
+
+		if (! isdigit((unsigned char)*p)) {
+			return -1;
+		}
+
+		first = strtoul(p, &end, 10);
+		last  = first;
+
+		if (*end == '-') {
+			if (! isdigit((unsigned char)end[1])) {
+				return -1;
+			}
+
+			last = strtoul(&end[1], &end, 10);
+		}
+
+		if ((last < first) || (last >= CPU_SETSIZE)) {
+			return -1;
+		}
+
+		for (; first <= last; first++) {
+			CPU_SET(first, cpus);
+		}
+
+		if (*end == ',') {
+			end += 1;
+		}
+		else if ((*end != '\0') && (*end != '\n')) {
+			return -1;
+		}
+
+		p = end;
+	}
+
+	return CPU_COUNT(cpus);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_NumaTopology:
+
+		Get NUMA nodes with any of the allowed CPUs (nodes without CPUs are left out).
+
+	Parameters:
+
+		allowed   -> CPUs that may be used (e.g. from 'sched_getaffinity').
+
+		nodes     -> Where to store nodes, only their allowed CPUs are kept.
+
+		max_nodes -> Size of 'nodes' (in items).
+
+	Return value:
+
+		Returns number of nodes, 1 (all allowed CPUs) if topology is not in sysfs.
+
+	---------------------------------------------------------------------------------------- */
+unsigned int m_NumaTopology(const cpu_set_t* allowed, TNumaNode* nodes, const unsigned int max_nodes) {
+
+	unsigned int RESULT = 0;
+	unsigned int lpp0;
+	char         path[64];
+	char         line[4096];
+
+	for (lpp0=0; (lpp0 < MAIN_MAX_NODES) && (RESULT < max_nodes); lpp0++) {
+		FILE* fd0;
+
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", lpp0);
+
+		fd0 = fopen(path, "r");
+
+		if (fd0 == NULL) {
+			// node numbers may have gaps
+			continue;
+		}
+
+		if ((fgets(line, sizeof(line), fd0) != NULL) && (m_ParseCPUList(line, &nodes[RESULT].cpus) >= 0)) {
+			CPU_AND(&nodes[RESULT].cpus, &nodes[RESULT].cpus, allowed);
+
+			if (CPU_COUNT(&nodes[RESULT].cpus) > 0) {
+				nodes[RESULT].id  = lpp0;
+				RESULT           += 1;
+			}
+		}
+
+		fclose(fd0);
+	}
+
+	if ((RESULT == 0) && (max_nodes > 0)) {
+		nodes[0].id   = 0;
+		nodes[0].cpus = *allowed;
+		RESULT        = 1;
+	}
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_NumaBind:
+
+		Pin calling thread to the CPUs of a NUMA node and make the node its preferred one for
+		memory. Threads it creates afterwards (KDF threads) inherit both.
+
+	---------------------------------------------------------------------------------------- */
+void m_NumaBind(const TNumaNode* node) {
+
+	unsigned long mask[(MAIN_MAX_NODES / (8 * sizeof(unsigned long))) + 1];
+
+	memset(mask, 0, sizeof(mask));
+
+	mask[node->id / (8 * sizeof(unsigned long))] |= 1UL << (node->id % (8 * sizeof(unsigned long)));
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &node->cpus) != 0) {
+		fprintf(stderr, "\nWarning: Could not pin thread to CPUs of NUMA node %u.\n", node->id);
+	}
+
+	// MPOL_PREFERRED (no glibc wrapper); not available if kernel was built without NUMA
+	if ((syscall(SYS_set_mempolicy, 1, mask, 8 * sizeof(mask)) != 0) && (errno != ENOSYS)) {
+		fprintf(stderr, "\nWarning: Could not prefer memory of NUMA node %u.\n", node->id);
+	}
+}
+
+typedef struct {
+	int           client;   // connection the job came from (result is written to it)
+	int           in_fd;    // input descriptor
+	int           out_fd;   // output descriptor
+	int           key_fd;   // key file descriptor (-1 if key is in the request)
+	char*         request;  // request data, fields below point into it
+	char*         key;
+	TXORencParams params;
+} TServerJob;
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t  not_empty;
+	pthread_cond_t  not_full;
+	TServerJob*     jobs;     // ring buffer of pending jobs
+	unsigned int    capacity; // maximum number of pending jobs (backpressure)
+	unsigned int    head;     // next job to be taken
+	unsigned int    count;    // number of pending jobs
+	TXORencParams   defaults; // parameters of every job (key type and arena are set per job)
+	pthread_cond_t  kdf_free;
+	TXORencArena**  arenas;      // KDF slots not in use, derived jobs take one (see 'm_ServerPlanMemory')
+	unsigned int*   arena_nodes; // node of every arena in 'arenas' (index in 'nodes')
+	unsigned int    arena_count;
+	TNumaNode*      nodes;       // NUMA nodes workers are pinned to ('--numa'; NULL if not pinned)
+	unsigned int    node_count;
+	unsigned int*   node_slots;  // number of KDF slots of every node
+} TServerQueue;
+
+typedef struct {
+	TServerQueue* queue;
+	unsigned int  node; // index in 'queue->nodes'
+} TServerWorker;
+
+// when set, files are processed by a 'xorenc --serve' daemon listening on this socket
+const char* m_client_socket = NULL;
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ServerQueuePush:
+
+		Add job to queue, waiting while the queue is full.
+
+	---------------------------------------------------------------------------------------- */
+void m_ServerQueuePush(TServerQueue* queue, const TServerJob job) {
+
+	pthread_mutex_lock(&queue->lock);
+
+	while (queue->count == queue->capacity) {
+		pthread_cond_wait(&queue->not_full, &queue->lock);
+	}
+
+	queue->jobs[(queue->head + queue->count) % queue->capacity] = job;
+	queue->count += 1;
+
+	pthread_cond_signal(&queue->not_empty);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ServerQueuePop:
+
+		Take next job from queue, waiting while the queue is empty.
+
+	---------------------------------------------------------------------------------------- */
+TServerJob m_ServerQueuePop(TServerQueue* queue) {
+
+	TServerJob RESULT;
+
+	pthread_mutex_lock(&queue->lock);
+
+	while (queue->count == 0) {
+		pthread_cond_wait(&queue->not_empty, &queue->lock);
+	}
+
+	RESULT = queue->jobs[queue->head];
+
+	queue->head   = (queue->head + 1) % queue->capacity;
+	queue->count -= 1;
+
+	pthread_cond_signal(&queue->not_full);
+	pthread_mutex_unlock(&queue->lock);
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ServerReadJob:
+
+		Read request from client connection and fill job with it. Reading gives up after
+		'SERVER_REQUEST_TIMEOUT' (see 'SO_RCVTIMEO' set by 'm_Serve'), even if the client
+		keeps sending a few bytes at a time.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int m_ServerReadJob(const int client, TServerJob* job) {
+
+	char*    fields[3];
+	int*     descriptors[3] = { &job->in_fd, &job->out_fd, &job->key_fd };
+	size_t   field_count    = 0;
+	size_t   length         = 0;
+	uint64_t deadline       = XORenc_clock() + ((uint64_t)SERVER_REQUEST_TIMEOUT * 1000000000);
+	size_t   lpp0, lpp1;
+
+	job->client  = client;
+	job->in_fd   = -1;
+	job->out_fd  = -1;
+	job->key_fd  = -1;
+	job->key     = NULL;
+	job->request = calloc(1, SERVER_REQUEST_SIZE);
+
+	memset(&job->params, 0, sizeof(job->params));
+
+	if (job->request == NULL) {
+		return -1;
+	}
+
+
+	// read until all fields of the request were received (descriptors come with the first bytes)
+	while ((length < SERVER_REQUEST_SIZE-1) && (XORenc_clock() < deadline)) {
+		char           control[CMSG_SPACE(sizeof(int) * 3)];
+		struct iovec   iov = { &job->request[length], SERVER_REQUEST_SIZE-1 - length };
+		struct msghdr  msg;
+		struct cmsghdr* cmsg;
+
+		memset(&msg, 0, sizeof(msg));
+
+		msg.msg_iov        = &iov;
+		msg.msg_iovlen     = 1;
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+
+		ssize_t r = recvmsg(client, &msg, MSG_CMSG_CLOEXEC);
+
+		if ((r < 0) && (errno == EINTR)) {
+			continue;
+		}
+		else if (r <= 0) {
+			// end of connection, error or timeout
+			break;
+		}
+
+		// take input, output and key descriptors once, any other descriptor is closed
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+				size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				bool   taken = (job->in_fd < 0) && ((count == 2) || (count == 3));
+
+				for (lpp1=0; lpp1 < count; lpp1++) {
+					int fd;
+
+					memcpy(&fd, CMSG_DATA(cmsg) + (lpp1 * sizeof(int)), sizeof(int));
+
+					if (taken) {
+						*descriptors[lpp1] = fd;
+					}
+					else {
+						close(fd);
+					}
+				}
+			}
+		}
+
+		length += r;
+
+		// count complete fields
+		field_count = 0;
+
+		for (lpp0=0; lpp0 < length; lpp0++) {
+			if (job->request[lpp0] == '\0') {
+				field_count++;
+			}
+		}
+
+		if (field_count >= 3) {
+			break;
+		}
+	}
+
+
+	// split fields
+	field_count = 0;
+	lpp0        = 0;
+
+	while ((lpp0 < length) && (field_count < 3)) {
+		fields[field_count++] = &job->request[lpp0];
+
+		lpp0 += strlen(&job->request[lpp0]) + 1;
+	}
+
+	if ((field_count < 3) || (strcmp(fields[0], "fd") != 0) || (job->in_fd < 0) || (job->out_fd < 0)) {
+		return -1;
+	}
+
+	job->params.cyclic_key = false;
+
+	if (strcmp(fields[1], "direct") == 0) {
+		job->params.key_type = Direct;
+	}
+	else if (strcmp(fields[1], "direct-cyclic") == 0) {
+		job->params.key_type   = Direct;
+		job->params.cyclic_key = true;
+	}
+	else if (strcmp(fields[1], "derived") == 0) {
+		job->params.key_type = Derived;
+	}
+	else {
+		return -1;
+	}
+
+	job->key = fields[2];
+
+	// a direct key in the request must be a byte sequence, it would be opened as a path otherwise
+	if ((job->params.key_type == Direct) && (job->key_fd < 0) && (! XORenc_key_is_byte_sequence(job->key))) {
+		return -1;
+	}
+
+	if ((job->params.key_type == Derived) && (job->key_fd >= 0)) {
+		return -1;
+	}
+
+	// key file is read through the descriptor of the client, never reopened by path ('0' means none, so it can not be used)
+	if (job->key_fd == 0) {
+		return -1;
+	}
+
+	job->params.key_fd = (job->key_fd > 0) ? job->key_fd : 0;
+
+	return 0;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ServerCloseJob:
+
+		Close connection and descriptors of job, wipe and free its request.
+
+	---------------------------------------------------------------------------------------- */
+void m_ServerCloseJob(TServerJob* job) {
+
+	if (job->in_fd >= 0) {
+		close(job->in_fd);
+	}
+
+	if (job->out_fd >= 0) {
+		close(job->out_fd);
+	}
+
+	if (job->key_fd >= 0) {
+		close(job->key_fd);
+	}
+
+	close(job->client);
+
+	if (job->request != NULL) {
+		explicit_bzero(job->request, SERVER_REQUEST_SIZE);
+		free(job->request);
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ServerWorker:
+
+		Worker thread, processes jobs from the queue. Derived jobs wait for a KDF slot, whose
+		arena keeps memory of derived blocks allocated between jobs; direct jobs never wait.
+
+		With '--numa' the worker is pinned to its node and takes a KDF slot of the same node,
+		so memory of derived blocks stays local (a node without slots takes any of them).
+
+	---------------------------------------------------------------------------------------- */
+void* m_ServerWorker(void* arg) {
+
+	TServerWorker* worker = arg;
+	TServerQueue*  queue  = worker->queue;
+
+	if (queue->nodes != NULL) {
+		m_NumaBind(&queue->nodes[worker->node]);
+	}
+
+	while (true) {
+		uint64_t     idle       = XORenc_clock();
+		TServerJob   job        = m_ServerQueuePop(queue);
+		char         reply[32];
+		unsigned int arena_node = 0; // node of KDF slot taken
+		unsigned int lpp0;
+		int          r;
+
+		// time spent waiting for a job shows up as 'idle' in trace
+		XORenc_trace_event(queue->defaults.trace, "idle", idle, XORenc_clock());
+
+		if (m_ServerReadJob(job.client, &job) < 0) {
+			if (write(job.client, "-2\n", 3) < 0) {
+				// client went away
+			}
+
+			m_ServerCloseJob(&job);
+
+			continue;
+		}
+
+		job.params.arena       = NULL;
+		job.params.trace       = queue->defaults.trace;
+		job.params.bwlimit     = queue->defaults.bwlimit;
+		job.params.kdf_threads = queue->defaults.kdf_threads;
+		job.params.io_size     = queue->defaults.io_size;
+
+		if (job.params.key_type == Derived) {
+			uint64_t wait = XORenc_clock();
+
+			pthread_mutex_lock(&queue->lock);
+
+			while (true) {
+				for (lpp0=0; (lpp0 < queue->arena_count) && (queue->arena_nodes[lpp0] != worker->node); lpp0++);
+
+				if ((lpp0 == queue->arena_count) && (queue->node_slots[worker->node] == 0) && (queue->arena_count > 0)) {
+					// node has no KDF slot of its own
+					lpp0 = 0;
+				}
+
+				if (lpp0 < queue->arena_count) {
+					break;
+				}
+
+				pthread_cond_wait(&queue->kdf_free, &queue->lock);
+			}
+
+			job.params.arena = queue->arenas[lpp0];
+			arena_node       = queue->arena_nodes[lpp0];
+
+			// keep free slots packed
+			queue->arena_count      -= 1;
+			queue->arenas[lpp0]      = queue->arenas[queue->arena_count];
+			queue->arena_nodes[lpp0] = queue->arena_nodes[queue->arena_count];
+
+			pthread_mutex_unlock(&queue->lock);
+
+			XORenc_trace_event(queue->defaults.trace, "kdf_wait", wait, XORenc_clock());
+		}
+
+		r = XORenc_encrypt_fd(job.in_fd, job.out_fd, job.key, job.params);
+
+		snprintf(reply, sizeof(reply), "%d\n", r);
+
+		if (write(job.client, reply, strlen(reply)) < 0) {
+			// client went away, nothing to report to
+		}
+
+		if (job.params.arena != NULL) {
+			pthread_mutex_lock(&queue->lock);
+
+			queue->arenas[queue->arena_count]      = job.params.arena;
+			queue->arena_nodes[queue->arena_count] = arena_node;
+			queue->arena_count                    += 1;
+
+			// waiting workers may be of other nodes, let each one check
+			pthread_cond_broadcast(&queue->kdf_free);
+			pthread_mutex_unlock(&queue->lock);
+		}
+
+		m_ServerCloseJob(&job);
+	}
+
+	return NULL;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ServerPlanMemory:
+
+		Fit daemon into memory budget: every worker needs its I/O buffers, and every KDF slot
+		(derived job running at the same time) needs memory of derived blocks. Workers are
+		kept first (direct jobs only need buffers), then as many KDF slots as fit.
+
+	Parameters:
+
+		budget  -> Memory budget (in bytes, 0 if unlimited).
+
+		workers -> Number of workers, reduced if their buffers do not fit.
+
+	Return value:
+
+		Returns number of KDF slots, or 0 if not even one derived job fits.
+
+	---------------------------------------------------------------------------------------- */
+unsigned int m_ServerPlanMemory(const size_t budget, unsigned long* workers) {
+
+	size_t buffers = XORenc_memory_footprint(XORENC_STAGE_READ) + XORenc_memory_footprint(XORENC_STAGE_KEY_LOAD);
+	size_t derived = XORenc_memory_derived();
+	size_t slots;
+
+	if (budget == 0) {
+		return *workers;
+	}
+
+	if (budget < buffers + derived) {
+		return 0;
+	}
+
+	if (*workers > (budget - derived) / buffers) {
+		*workers = (budget - derived) / buffers;
+	}
+
+	slots = (budget - (*workers * buffers)) / derived;
+
+	return (slots < *workers) ? slots : *workers;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_Serve:
+
+		Run as daemon, listening for jobs on a Unix socket. (Option: --serve, -S)
+
+	Parameters:
+
+		socket_path -> Path of Unix socket to listen on.
+
+		workers     -> Number of jobs processed at the same time.
+
+		queue_size  -> Number of accepted jobs waiting for a worker; once reached new
+		               connections are only accepted when a job is taken (backpressure).
+
+		kdf_slots   -> Number of derived jobs processed at the same time (see 'm_ServerPlanMemory').
+
+		defaults    -> Parameters of every job (trace, bandwidth and KDF thread limits).
+
+	Return value:
+
+		Only returns if it fails.
+
+	---------------------------------------------------------------------------------------- */
+int m_Serve(const char* socket_path, const unsigned int workers, const unsigned int queue_size, const unsigned int kdf_slots, const TXORencParams defaults) {
+
+	TServerQueue       queue;
+	TServerWorker*     worker_args;
+	struct sockaddr_un address;
+	struct stat        socket_stat;
+	cpu_set_t          allowed;
+	pthread_t          thread;
+	unsigned int       lpp0;
+	int                fd0;
+
+	if (strlen(socket_path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "\nError: Socket path is too long.\n");
+
+		return -1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&queue, 0, sizeof(queue));
+
+	pthread_mutex_init(&queue.lock, NULL);
+	pthread_cond_init(&queue.not_empty, NULL);
+	pthread_cond_init(&queue.not_full, NULL);
+	pthread_cond_init(&queue.kdf_free, NULL);
+
+	queue.capacity = queue_size;
+	queue.defaults = defaults;
+	queue.jobs     = calloc(queue_size, sizeof(TServerJob));
+	queue.arenas   = calloc(kdf_slots, sizeof(TXORencArena*));
+
+	queue.arena_nodes = calloc(kdf_slots, sizeof(unsigned int));
+	queue.node_count  = 1;
+	worker_args       = calloc(workers, sizeof(TServerWorker));
+
+	// spread workers and KDF slots over NUMA nodes of allowed CPUs ('--cpus')
+	if ((m_numa) && (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)) {
+		queue.nodes = calloc(MAIN_MAX_NODES, sizeof(TNumaNode));
+
+		if (queue.nodes != NULL) {
+			queue.node_count = m_NumaTopology(&allowed, queue.nodes, MAIN_MAX_NODES);
+		}
+	}
+
+	queue.node_slots = calloc(queue.node_count, sizeof(unsigned int));
+
+	for (lpp0=0; (queue.arenas != NULL) && (queue.arena_nodes != NULL) && (queue.node_slots != NULL) && (lpp0 < kdf_slots); lpp0++) {
+		queue.arenas[lpp0]      = XORenc_arena_create();
+		queue.arena_nodes[lpp0] = lpp0 % queue.node_count;
+
+		queue.node_slots[lpp0 % queue.node_count] += 1;
+	}
+
+	queue.arena_count = kdf_slots;
+
+	if ((queue.jobs == NULL) || (queue.arenas == NULL) || (queue.arena_nodes == NULL) || (queue.node_slots == NULL) || (worker_args == NULL) || ((m_numa) && (queue.nodes == NULL))) {
+		fprintf(stderr, "\nError: Could not allocate memory.\n");
+
+		return -1;
+	}
+
+
+	// listen on socket (a stale socket left by a previous daemon is removed)
+	if ((lstat(socket_path, &socket_stat) == 0) && (S_ISSOCK(socket_stat.st_mode))) {
+		unlink(socket_path);
+	}
+
+	memset(&address, 0, sizeof(address));
+
+	address.sun_family = AF_UNIX;
+
+	strcpy(address.sun_path, socket_path);
+
+	fd0 = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if ((fd0 < 0) || (bind(fd0, (struct sockaddr*)&address, sizeof(address)) != 0) || (listen(fd0, queue_size) != 0)) {
+		fprintf(stderr, "\nError: Could not listen on socket \"%s\".\n", socket_path);
+
+		return -1;
+	}
+
+
+	for (lpp0=0; lpp0 < workers; lpp0++) {
+		worker_args[lpp0].queue = &queue;
+		worker_args[lpp0].node  = lpp0 % queue.node_count;
+
+		if (pthread_create(&thread, NULL, m_ServerWorker, &worker_args[lpp0]) != 0) {
+			fprintf(stderr, "\nError: Could not start worker thread.\n");
+
+			return -1;
+		}
+
+		pthread_detach(thread);
+	}
+
+	if (queue.nodes != NULL) {
+		fprintf(stderr, "\nWorkers and KDF slots spread over %u NUMA node(s).\n", queue.node_count);
+	}
+
+	fprintf(stderr, "\nListening on \"%s\" (%u worker(s), %u derived at the same time, queue of %u job(s))...\n", socket_path, workers, kdf_slots, queue_size);
+
+
+	// requests are read by workers, so a slow client never holds back accepting others
+	while (true) {
+		TServerJob     job;
+		struct timeval timeout = { SERVER_REQUEST_TIMEOUT, 0 };
+		int            client  = accept4(fd0, NULL, NULL, SOCK_CLOEXEC);
+
+		if (client < 0) {
+			continue;
+		}
+
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		memset(&job, 0, sizeof(job));
+
+		job.client = client;
+
+		m_ServerQueuePush(&queue, job);
+	}
+
+	return -1;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ClientProcessFile:
+
+		Process input file by sending it to a daemon (started with '--serve'). (Option: --client, -c)
+
+		Input, output and key file are opened here and passed to the daemon as descriptors, so
+		they are accessed with the permissions of the client.
+
+	Parameters:
+
+		socket_path -> Path of Unix socket the daemon listens on.
+
+		filename    -> Path to file to be encrypted. Must be NULL if input is to be read from standard input (stdin).
+
+		key         -> Corresponds to key in one of the three available formats: path to file, byte sequence, or common string.
+
+		std_out     -> Output file to standard output (stdout)?
+
+		params      -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int m_ClientProcessFile(const char* socket_path, const char* filename, const char* key, const bool std_out, const TXORencParams params) {
+
+	struct sockaddr_un address;
+	char*              request;
+	size_t             request_len;
+	char*              out_filename = NULL; // output file created here (removed if job fails)
+	int                fds[3]    = { STDIN_FILENO, STDOUT_FILENO, -1 }; // input, output, key file
+	size_t             fd_count  = 2;
+	int                fd0;
+	int                r = XORENC_ERROR_OUTPUT;
+
+	if ((strlen(socket_path) >= sizeof(address.sun_path)) || (strlen(key) > SERVER_REQUEST_SIZE - 64)) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	// open key file (byte sequences and passwords are sent in the request)
+	if ((params.key_type == Direct) && (! XORenc_key_is_byte_sequence(key))) {
+		fds[2] = open(key, O_RDONLY | O_CLOEXEC);
+
+		if (fds[2] < 0) {
+			return XORENC_ERROR_KEY;
+		}
+
+		key      = "";
+		fd_count = 3;
+	}
+
+
+	// open input and output
+	if (filename != NULL) {
+		fds[0] = open(filename, O_RDONLY);
+
+		if (fds[0] < 0) {
+			if (fds[2] >= 0) {
+				close(fds[2]);
+			}
+
+			return XORENC_ERROR_INPUT;
+		}
+	}
+
+	if ((filename != NULL) && (std_out == false)) {
+		out_filename = malloc(strlen(filename) + sizeof(".xen"));
+
+		if (out_filename == NULL) {
+			close(fds[0]);
+
+			if (fds[2] >= 0) {
+				close(fds[2]);
+			}
+
+			return XORENC_ERROR_MEMORY;
+		}
+
+		sprintf(out_filename, "%s.xen", filename);
+
+		fds[1] = open(out_filename, O_WRONLY | O_CREAT | O_EXCL, 0666);
+
+		if (fds[1] < 0) {
+			free(out_filename);
+			close(fds[0]);
+
+			if (fds[2] >= 0) {
+				close(fds[2]);
+			}
+
+			return XORENC_ERROR_OUTPUT;
+		}
+	}
+
+
+	// connect and send request
+	memset(&address, 0, sizeof(address));
+
+	address.sun_family = AF_UNIX;
+
+	strcpy(address.sun_path, socket_path);
+
+	request     = calloc(1, SERVER_REQUEST_SIZE);
+	request_len = 0;
+	fd0         = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if ((request != NULL) && (fd0 >= 0) && (connect(fd0, (struct sockaddr*)&address, sizeof(address)) == 0)) {
+		char            control[CMSG_SPACE(sizeof(fds))];
+		char            reply[32] = { 0 };
+		struct iovec    iov;
+		struct msghdr   msg;
+		struct cmsghdr* cmsg;
+
+		request_len += sprintf(&request[request_len], "fd") + 1;
+		request_len += sprintf(&request[request_len], "%s", (params.key_type == Derived) ? "derived" : ((params.cyclic_key) ? "direct-cyclic" : "direct")) + 1;
+		request_len += sprintf(&request[request_len], "%s", key) + 1;
+
+		iov.iov_base = request;
+		iov.iov_len  = request_len;
+
+		memset(&msg, 0, sizeof(msg));
+		memset(control, 0, sizeof(control));
+
+		msg.msg_iov        = &iov;
+		msg.msg_iovlen     = 1;
+		msg.msg_control    = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+
+		cmsg             = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type  = SCM_RIGHTS;
+		cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * fd_count);
+
+		memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fd_count);
+
+		if ((sendmsg(fd0, &msg, 0) == (ssize_t)request_len) && (read(fd0, reply, sizeof(reply)-1) > 0)) {
+			r = atoi(reply);
+		}
+	}
+	else {
+		fprintf(stderr, "\nError: Could not connect to daemon at \"%s\".\n", socket_path);
+	}
+
+
+	if (fd0 >= 0) {
+		close(fd0);
+	}
+
+	if (request != NULL) {
+		// request holds password or byte sequence
+		explicit_bzero(request, SERVER_REQUEST_SIZE);
+		free(request);
+	}
+
+	if ((out_filename != NULL) && (r < 0)) {
+		unlink(out_filename);
+	}
+
+	free(out_filename);
+
+	if (fds[0] != STDIN_FILENO) {
+		close(fds[0]);
+	}
+
+	if (fds[1] != STDOUT_FILENO) {
+		close(fds[1]);
+	}
+
+	if (fds[2] >= 0) {
+		close(fds[2]);
+	}
+
+	return r;
+}
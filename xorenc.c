@@ -1,7 +1,18 @@
 // Warning: Best read if using a monospaced/fixed-width font and tab width of 4.
-#include <argon2.h>
-#include <libscrypt.h>
-#include <libavutil/md5.h>
+#include "xorenc.h"
+//---
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h> // CRC32C instruction (SSE4.2), see 'XORenc_crc32c'
+#endif
+//---
+#include <argon2.h>    // loaded at run time, see 'XORenc_kdf_load'
+#include <libscrypt.h> // loaded at run time, see 'XORenc_kdf_load'
 
 /** ================================================================================
 
@@ -37,26 +48,18 @@
 
 const uint32_t XORENC_MIN_PASSWORD_LENGTH = 8;
 const size_t   XORENC_FILE_BLOCK_SIZE     = 1024 * 1024; // 1024 bytes * 1024 = 1 MiB
+const size_t   XORENC_IO_SIZE_MAX         = 16 * 1024 * 1024; // largest read/write request, see 'XORenc_io_size'
+static const size_t XORENC_IO_SIZE_FILE = 8 * 1024 * 1024; // requests to regular files and block devices
+static const size_t XORENC_IO_SIZE_PIPE = 64 * 1024;       // requests to pipes, sockets and terminals (default pipe capacity)
 const char*    XORENC_SALT                = "3XsCYUXjzoubgVeWADLV65iVhpbkGd1A6FUYiHVf4gzn735b";
 
-typedef enum {
-	Direct=1,
-	Derived
-} TXORencKeyType;
-
-typedef struct {
-	void*  data;
-	size_t length;
-} TXORencKey;
-
-typedef struct {
-	TXORencKeyType key_type; // the type of the key
-} TXORencParams;
-
-typedef struct {
-	uint8_t* data;
-	size_t   length;
-} TXORencHash;
+// KDF parameters (changing any of them changes the derived keystream!)
+static const uint32_t XORENC_ARGON2_ITERATIONS = 7;         // number of iterations
+static const uint32_t XORENC_ARGON2_MEMORY     = 131072;    // memory in KiB
+static const uint32_t XORENC_ARGON2_THREADS    = 2;         // number of threads
+static const uint64_t XORENC_SCRYPT_N          = 1024 * 32; // CPU and RAM cost
+static const uint32_t XORENC_SCRYPT_R          = 16;        // RAM cost
+static const uint32_t XORENC_SCRYPT_P          = 2;         // CPU cost (parallelisation)
 
 /** ----------------------------------------------------------------------------------------
 
@@ -159,12 +162,88 @@ char* XORenc_int2hex(size_t n, unsigned int pad, bool lowercase) {
 	---------------------------------------------------------------------------------------- */
 void XORenc_md5(const uint8_t* data, const size_t data_len, uint8_t* digest_b, char* digest_s) {
 
-	size_t lpp0;
-	struct AVMD5* md5_ctx = calloc(1, av_md5_size);
-  
-	av_md5_init(md5_ctx);
+	// per round shift amounts and constants (RFC 1321)
+	static const uint8_t  S[64] = { 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+	                                5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+	                                4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+	                                6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21 };
+	static const uint32_t K[64] = { 0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+	                                0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+	                                0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+	                                0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+	                                0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+	                                0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+	                                0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+	                                0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+
+	uint32_t h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	uint8_t  tail[128];  // last (partial) chunk of data plus padding
+	size_t   tail_len;
+	size_t   lpp0, lpp1;
+
+	// padding: 0x80, zeros, then message length in bits (little endian)
+	tail_len = data_len % 64;
+
+	memcpy(tail, &data[data_len - tail_len], tail_len);
+
+	tail[tail_len++] = 0x80;
+
+	while ((tail_len % 64) != 56) {
+		tail[tail_len++] = 0;
+	}
+
+	for (lpp0=0; lpp0 < 8; lpp0++) {
+		tail[tail_len++] = (uint8_t)(((uint64_t)data_len * 8) >> (lpp0 * 8));
+	}
+
+
+	// process every 64 bytes chunk (whole chunks straight from 'data', then the tail)
+	for (lpp1=0; lpp1 < (data_len / 64) + (tail_len / 64); lpp1++) {
+		const uint8_t* chunk = (lpp1 < (data_len / 64)) ? &data[lpp1 * 64] : &tail[(lpp1 - (data_len / 64)) * 64];
+		uint32_t       M[16];
+		uint32_t       a = h[0], b = h[1], c = h[2], d = h[3];
+
+		for (lpp0=0; lpp0 < 16; lpp0++) {
+			M[lpp0] = (uint32_t)chunk[(lpp0*4)+0] | ((uint32_t)chunk[(lpp0*4)+1] << 8) | ((uint32_t)chunk[(lpp0*4)+2] << 16) | ((uint32_t)chunk[(lpp0*4)+3] << 24);
+		}
+
+		for (lpp0=0; lpp0 < 64; lpp0++) {
+			uint32_t f;
+			size_t   g;
+
+			if (lpp0 < 16) {
+				f = (b & c) | (~b & d);
+				g = lpp0;
+			}
+			else if (lpp0 < 32) {
+				f = (d & b) | (~d & c);
+				g = ((5 * lpp0) + 1) % 16;
+			}
+			else if (lpp0 < 48) {
+				f = b ^ c ^ d;
+				g = ((3 * lpp0) + 5) % 16;
+			}
+			else {
+				f = c ^ (b | ~d);
+				g = (7 * lpp0) % 16;
+			}
+
+			f = f + a + K[lpp0] + M[g];
+			a = d;
+			d = c;
+			c = b;
+			b = b + ((f << S[lpp0]) | (f >> (32 - S[lpp0])));
+		}
+
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+	}
 
-	av_md5_sum(digest_b, data, data_len);
+	for (lpp0=0; lpp0 < 16; lpp0++) {
+		digest_b[lpp0] = (uint8_t)(h[lpp0 / 4] >> ((lpp0 % 4) * 8));
+	}
   
 
 	for (lpp0=0; lpp0 < 16; lpp0++) {
@@ -175,444 +254,1508 @@ void XORenc_md5(const uint8_t* data, const size_t data_len, uint8_t* digest_b, c
   	
 		free(tmp);
 	}
+}
+
+/** ----------------------------------------------------------------
+
+	Static tracepoints (USDT), compiled in when 'sys/sdt.h' is
+	available (see Makefile). Every stage has a '<stage>_start'
+	probe and a '<stage>_end' probe in provider 'xorenc', the end
+	probe gets the time spent in the stage (in nanoseconds):
+
+		bpftrace -e 'usdt:./xorenc:xorenc:argon2_end { @ = hist(arg0); }'
+
+	Every probe has a semaphore, which a tracer increments while the
+	probe is attached; the clock is only read for a stage when one of
+	its probes is attached (or statistics/trace are requested).
+
+	---------------------------------------------------------------- */
+#ifdef XORENC_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define XORENC_PROBE_SEMAPHORES(name) \
+	__extension__ unsigned short xorenc_##name##_start_semaphore __attribute__((unused)) __attribute__((section(".probes"))); \
+	__extension__ unsigned short xorenc_##name##_end_semaphore   __attribute__((unused)) __attribute__((section(".probes")));
+
+XORENC_PROBE_SEMAPHORES(read)
+XORENC_PROBE_SEMAPHORES(key_load)
+XORENC_PROBE_SEMAPHORES(argon2)
+XORENC_PROBE_SEMAPHORES(scrypt)
+XORENC_PROBE_SEMAPHORES(md5)
+XORENC_PROBE_SEMAPHORES(xor)
+XORENC_PROBE_SEMAPHORES(write)
+XORENC_PROBE_SEMAPHORES(compress)
+
+#define XORENC_PROBE_ENABLED(stage) XORenc_probe_enabled(stage)
+
+#define XORENC_PROBE_STAGE(stage, end, ns) \
+	switch (stage) { \
+		case XORENC_STAGE_READ:     if (end) { DTRACE_PROBE1(xorenc, read_end, ns);     } else { DTRACE_PROBE(xorenc, read_start);     } break; \
+		case XORENC_STAGE_KEY_LOAD: if (end) { DTRACE_PROBE1(xorenc, key_load_end, ns); } else { DTRACE_PROBE(xorenc, key_load_start); } break; \
+		case XORENC_STAGE_ARGON2:   if (end) { DTRACE_PROBE1(xorenc, argon2_end, ns);   } else { DTRACE_PROBE(xorenc, argon2_start);   } break; \
+		case XORENC_STAGE_SCRYPT:   if (end) { DTRACE_PROBE1(xorenc, scrypt_end, ns);   } else { DTRACE_PROBE(xorenc, scrypt_start);   } break; \
+		case XORENC_STAGE_MD5:      if (end) { DTRACE_PROBE1(xorenc, md5_end, ns);      } else { DTRACE_PROBE(xorenc, md5_start);      } break; \
+		case XORENC_STAGE_XOR:      if (end) { DTRACE_PROBE1(xorenc, xor_end, ns);      } else { DTRACE_PROBE(xorenc, xor_start);      } break; \
+		case XORENC_STAGE_WRITE:    if (end) { DTRACE_PROBE1(xorenc, write_end, ns);    } else { DTRACE_PROBE(xorenc, write_start);    } break; \
+		case XORENC_STAGE_COMPRESS: if (end) { DTRACE_PROBE1(xorenc, compress_end, ns); } else { DTRACE_PROBE(xorenc, compress_start); } break; \
+		default: break; \
+	}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_probe_enabled:
 
+		Check if a tracer is attached to a probe of a stage (see its semaphores).
 
-	free(md5_ctx);
+	---------------------------------------------------------------------------------------- */
+static bool XORenc_probe_enabled(const TXORencStage stage) {
+
+	static const volatile unsigned short* const SEMAPHORES[XORENC_STAGE_COUNT][2] = {
+		{ &xorenc_read_start_semaphore,     &xorenc_read_end_semaphore     },
+		{ &xorenc_key_load_start_semaphore, &xorenc_key_load_end_semaphore },
+		{ &xorenc_argon2_start_semaphore,   &xorenc_argon2_end_semaphore   },
+		{ &xorenc_scrypt_start_semaphore,   &xorenc_scrypt_end_semaphore   },
+		{ &xorenc_md5_start_semaphore,      &xorenc_md5_end_semaphore      },
+		{ &xorenc_xor_start_semaphore,      &xorenc_xor_end_semaphore      },
+		{ &xorenc_write_start_semaphore,    &xorenc_write_end_semaphore    },
+		{ &xorenc_compress_start_semaphore, &xorenc_compress_end_semaphore }
+	};
+
+	return (stage < XORENC_STAGE_COUNT) && ((*SEMAPHORES[stage][0] != 0) || (*SEMAPHORES[stage][1] != 0));
 }
+#else
+#define XORENC_PROBE_STAGE(stage, end, ns)
+#define XORENC_PROBE_ENABLED(stage) false
+#endif
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_hash_scrypt:
-
-		Generate 'Scrypt' hash of 'XORENC_FILE_BLOCK_SIZE' in length.
-      
-		Result hash is written in binary, as an array of byte in 'hash.data'.
+	XORenc_clock:
 
-	Parameters:
+		Get current time of monotonic clock.
 
-		pass     -> Input password as string.
-        
-		pass_len -> Length of password string.
-        
-		salt     -> Input salt as string.
-        
-		salt_len -> Length of salt string.
-        
 	Return value:
 
-		Returns derived data as TXORencHash.
+		Returns current time (in nanoseconds).
 
 	---------------------------------------------------------------------------------------- */
-TXORencHash XORenc_hash_scrypt(	const char*  pass,
-								const size_t pass_len,
-								const char*  salt,
-								const size_t salt_len ) {
+uint64_t XORenc_clock() {
 
-	TXORencHash RESULT;
+	struct timespec now;
 
-	/* ******* --- XORenc_hash_scrypt --- ******* */
+	clock_gettime(CLOCK_MONOTONIC, &now);
 
-	RESULT.data   = NULL;
-	RESULT.length = XORENC_FILE_BLOCK_SIZE;
+	return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
 
-	RESULT.data = malloc(XORENC_FILE_BLOCK_SIZE);
+/** ----------------------------------------------------------------------------------------
 
-	if (RESULT.data == NULL) {
-		RESULT.length = 0;
+	XORenc_stage_name:
 
-		return RESULT;
-	}
-	
-	
-	// set 'Scrypt' parameters and generate hash
-	const char*  password        = pass;          // password
-	const size_t password_length = pass_len;      // password length
-	const char*  salt_           = salt;          // salt
-	const size_t salt_length     = salt_len;      // salt length
-	uint64_t     scrypt_N        = 1024 * 32;     // CPU and RAM cost
-	uint32_t     scrypt_r        = 16;            // RAM cost
-	uint32_t     scrypt_p        = 2;             // CPU cost (parallelisation)
-	uint8_t*     hash            = RESULT.data;   // where to write result hash
-	const size_t hash_len        = RESULT.length; // length of hash to write
+		Get name of a stage of processing (as used in trace events and probes).
 
-	int r = libscrypt_scrypt((uint8_t*)password, password_length, (uint8_t*)salt_, salt_length, scrypt_N, scrypt_r, scrypt_p, hash, hash_len);
+	---------------------------------------------------------------------------------------- */
+const char* XORenc_stage_name(const TXORencStage stage) {
 
-	if (r != 0) {
-		// operation failed! :(
-		free(RESULT.data);
-		
-		RESULT.data = NULL;
-		
-		return RESULT;
-	}
+	const char* NAMES[XORENC_STAGE_COUNT] = { "read", "key_load", "argon2", "scrypt", "md5", "xor", "write", "compress" };
 
+	return (stage < XORENC_STAGE_COUNT) ? NAMES[stage] : "unknown";
+}
 
-	return RESULT;
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_trace_event:
+
+		Write a Chrome trace event ("complete" event) for something that ran between 'begin'
+		and 'end' in the calling thread.
+
+	Parameters:
+
+		trace -> Where to write the event (if NULL nothing is done).
+
+		name  -> Name of the event.
+
+		begin -> Time it started (see 'XORenc_clock').
+
+		end   -> Time it ended (see 'XORenc_clock').
+
+	---------------------------------------------------------------------------------------- */
+void XORenc_trace_event(FILE* trace, const char* name, const uint64_t begin, const uint64_t end) {
+
+	if (trace == NULL) {
+		return;
+	}
+
+	// one call per event, so events of different threads are never mixed up
+	fprintf(trace, "{\"name\": \"%s\", \"cat\": \"xorenc\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d},\n",
+			name, begin / 1e3, (end - begin) / 1e3, (int)getpid(), (int)gettid());
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_hash_argon2:
+	XORenc_stats_begin:
 
-		Generate 'Argon2' hash of 'XORENC_FILE_BLOCK_SIZE' in length.
-      
-		Result hash is written in binary, as an array of byte in 'hash.data'.
+		Start timing a stage of processing.
 
 	Parameters:
 
-		pass     -> Input password as string.
-        
-		pass_len -> Length of password string.
-        
-		salt     -> Input salt as string.
-        
-		salt_len -> Length of salt string.
-        
+		params -> Parameters with statistics/trace the stage is added to (may be NULL).
+
+		stage  -> The stage that starts.
+
 	Return value:
 
-		Returns derived data as TXORencHash.
+		Returns current time of monotonic clock (in nanoseconds), to be given to 'XORenc_stats_end',
+		or 0 if the stage is not timed (no statistics, trace or attached probe).
 
 	---------------------------------------------------------------------------------------- */
-TXORencHash XORenc_hash_argon2(	const char*  pass,
-								const size_t pass_len,
-								const char*  salt,
-								const size_t salt_len ) {
+uint64_t XORenc_stats_begin(const TXORencParams* params, const TXORencStage stage) {
 
-	TXORencHash RESULT;
+	XORENC_PROBE_STAGE(stage, false, 0);
 
-	/* ******* --- XORenc_hash_argon2 --- ******* */
+	if ((! XORENC_PROBE_ENABLED(stage)) && ((params == NULL) || ((params->stats == NULL) && (params->trace == NULL)))) {
+		return 0;
+	}
 
-	RESULT.data   = NULL;
-	RESULT.length = XORENC_FILE_BLOCK_SIZE;
+	return XORenc_clock();
+}
 
-	RESULT.data = malloc(XORENC_FILE_BLOCK_SIZE);
+/** ----------------------------------------------------------------------------------------
 
-	if (RESULT.data == NULL) {
-		RESULT.length = 0;
-	
-		return RESULT;
-	}
-	
-	
-	// set 'Argon2' parameters and generate hash
-	const uint32_t iterations      = 7;             // number of iterations
-	const uint32_t memory          = 131072;        // memory in KiB
-	const uint32_t threads         = 2;             // number of threads
-	const char*    password        = pass;          // password
-	const size_t   password_length = pass_len;      // password length
-	const char*    salt_           = salt;          // salt
-	const size_t   salt_length     = salt_len;      // salt length
-	uint8_t*       hash            = RESULT.data;   // where to write result hash
-	const size_t   hash_len        = RESULT.length; // length of hash to write
+	XORenc_stats_end:
 
-	int r = argon2i_hash_raw(iterations, memory, threads, password, password_length, salt_, salt_length, hash, hash_len);
-		
-	if (r != ARGON2_OK) {
-		// operation failed! :(
-		free(RESULT.data);
-		
-		RESULT.data = NULL;
-		
-		return RESULT;
-	}
+		Finish timing a stage of processing, adding time spent since 'begin' to it.
 
+	Parameters:
 
-	return RESULT;
-}
+		params -> Parameters with statistics/trace the stage is added to (may be NULL).
 
-bool XORenc_key_is_byte_sequence(const char* key) {
+		stage  -> The stage that ran.
 
-	// check if input key is of the format: 'XX XX XX...' -> Where 'X' is anything in the range 0-9 and A-F.
-	
-	size_t lpp0;
-	
-	/* ******* --- XORenc_key_is_byte_sequence --- ******* */
-	
-	if (strlen(key) < 2) {
-		// not a valid byte sequence key
-		return false;
+		begin  -> Value returned by 'XORenc_stats_begin' when the stage started.
+
+	---------------------------------------------------------------------------------------- */
+void XORenc_stats_end(const TXORencParams* params, const TXORencStage stage, const uint64_t begin) {
+
+	uint64_t end;
+
+	// not timed when it started (a probe attached meanwhile waits for the next stage)
+	if (begin == 0) {
+		return;
 	}
-	
-	
-	// length of key must be a multiple of 3 or a multiple of 3-1
-	if ((((strlen(key) + 0) % 3) == 0) || (((strlen(key) + 1) % 3) == 0)) {
-		// length is OK, it can be a byte sequence key; let's check it! :)
-		lpp0 = 0;
-		
-		while (lpp0 < strlen(key)) {
-			if (((key[lpp0] < '0') || (key[lpp0] > '9')) && ((key[lpp0] < 'A') || (key[lpp0] > 'F'))) {
-				// not a valid byte sequence key
-				return false;
-			}
-			
-			lpp0 += 1;
-			
-			if (((key[lpp0] < '0') || (key[lpp0] > '9')) && ((key[lpp0] < 'A') || (key[lpp0] > 'F'))) {
-				// not a valid byte sequence key
-				return false;
-			}
-			
-			lpp0 += 1;
-			
-			if (lpp0 < strlen(key)) {
-				// check for a space
-				if (key[lpp0] != ' ') {
-					return false;
-				}
-			}
-			
-			lpp0 += 1;
-		}
+
+	end = XORenc_clock();
+
+	XORENC_PROBE_STAGE(stage, true, end - begin);
+
+	if (params == NULL) {
+		return;
 	}
-	else {
-		return false;
+
+	if (params->stats != NULL) {
+		params->stats->time_ns[stage] += end - begin;
+		params->stats->calls[stage]   += 1;
 	}
-	
-	// survived until here, return 'true' :)
-	return true;
+
+	XORenc_trace_event(params->trace, XORenc_stage_name(stage), begin, end);
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_key_load:
+	XORenc_memory_footprint:
 
-		Load a key from file or command line (option '--key, -k') and returns it.
-      
-		This function can be used to load keys when encrypting with 'XORenc_encrypt_direct'.
+		Get memory needed while a stage of processing runs (peak, in bytes). Memory of
+		'Argon2' stays allocated in an arena between blocks (see 'XORenc_arena_create').
 
 	Parameters:
 
-		str       -> Refers to path to a key file or key in the format:
-        
-			'XX XX XX...'
-                 
-			Where 'X' is anything in the range 0-9 and A-F.
-        
-		block     -> Block of key to be retrieved (0->whole key is loaded; >=1->first/Nth block).
-        
-		block_len -> The actual length of the block or the key.
-        
-	Return value:
-			
-		The pointer to key data of size 'block_len'.
-				
-		Returns 'NULL' if it fails.
+		stage -> The stage.
 
 	---------------------------------------------------------------------------------------- */
-TXORencKey XORenc_key_load(const char* str, const size_t block) {
+size_t XORenc_memory_footprint(const TXORencStage stage) {
 
-	TXORencKey RESULT;
-	FILE*      fd0;
-	// loop vars
-	size_t lpp0, lpp1;
-	
-	/* ******* --- XORenc_key_load --- ******* */
-	
-	RESULT.data = malloc(XORENC_FILE_BLOCK_SIZE);
-	
-	if (RESULT.data == NULL) {
-		return RESULT;
-	}
+	switch (stage) {
+		case XORENC_STAGE_READ:
+		case XORENC_STAGE_WRITE:
+			// I/O buffer, see 'XORenc_io_size'
+			return XORENC_IO_SIZE_MAX;
 
+		case XORENC_STAGE_KEY_LOAD:
+			// block buffer (key files are mapped, their pages belong to page cache)
+			return XORENC_FILE_BLOCK_SIZE;
 
-	// check if file exists and is accessible
-	if (access(str, R_OK) == 0) {
-		// file exists, it is key file :)
-		fd0 = fopen(str, "rb");
-		
-		if (fd0 == NULL) {
-			// could not open file
-			free(RESULT.data);
-			
-			RESULT.data   = NULL;
-			RESULT.length = 0;
-			
-			return RESULT;
-		}
+		case XORENC_STAGE_ARGON2:
+			// working memory + derived data
+			return ((size_t)XORENC_ARGON2_MEMORY * 1024) + XORENC_FILE_BLOCK_SIZE;
 
+		case XORENC_STAGE_SCRYPT:
+			// working memory (V + B) + derived data
+			return (128 * (size_t)XORENC_SCRYPT_R * XORENC_SCRYPT_N) + (128 * (size_t)XORENC_SCRYPT_R * XORENC_SCRYPT_P) + XORENC_FILE_BLOCK_SIZE;
 
-		if (block == 0) {
-			// single block load
-			RESULT.length = fread(RESULT.data, 1, XORENC_FILE_BLOCK_SIZE, fd0);
-			
-			if (RESULT.length > 0) {
-				// key was loaded successfully! :)
-				fclose(fd0);
-				
-				return RESULT;
-			}
-		}
-		else {
-			// block load
-			fseek(fd0, XORENC_FILE_BLOCK_SIZE * block, SEEK_SET);
-			
-			RESULT.length = fread(RESULT.data, 1, XORENC_FILE_BLOCK_SIZE, fd0);
-			
-			if (RESULT.length == 0) {
-				// could not load block from file
-				fclose(fd0);
-				
-				free(RESULT.data);
-				
-				RESULT.data   = NULL;
-				RESULT.length = 0;
-				
-				return RESULT;
-			}
-			else {
-				// key was loaded successfully! :)
-				fclose(fd0);
-				
-				return RESULT;
-			}
-		}
+		case XORENC_STAGE_COMPRESS:
+			// block buffer + compressed block (library working memory is not counted)
+			return 2 * XORENC_FILE_BLOCK_SIZE;
+
+		default:
+			return 0;
 	}
-	else if ((XORenc_key_is_byte_sequence(str) == true) && (block == 0)) {
-		// it is byte sequence of type: 'XX XX XX...'; convert it to binary...
-		uint8_t* key_data = RESULT.data;
-		
-		lpp0 = 0;
-		lpp1 = 0;
-		
-		while (lpp0 < strlen(str)) {
-			// high order digit
-			if ((str[lpp0] >= 'A') && (str[lpp0] <= 'F')) {
-				key_data[lpp1] = (str[lpp0] - 0x37) << 4;
-			}
-			else if ((str[lpp0] >= '0') && (str[lpp0] <= '9')) {
-				key_data[lpp1] = (str[lpp0] - 0x30) << 4;
-			}
-			
-			
-			lpp0 += 1;
-			
-			
-			// low order digit
-			if ((str[lpp0] >= 'A') && (str[lpp0] <= 'F')) {
-				key_data[lpp1] |= str[lpp0] - 0x37;
-			}
-			else if ((str[lpp0] >= '0') && (str[lpp0] <= '9')) {
-				key_data[lpp1] |= str[lpp0] - 0x30;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_kdf_threads:
+
+		Get number of threads a derived block uses at most (Scrypt runs in one thread).
+
+	---------------------------------------------------------------------------------------- */
+unsigned int XORenc_kdf_threads() {
+
+	return XORENC_ARGON2_THREADS;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_memory_derived:
+
+		Get memory needed to generate derived blocks (peak, in bytes): 'Scrypt' runs while
+		'Argon2' memory is kept by the arena and its derived data is still needed.
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_memory_derived() {
+
+	return XORenc_memory_footprint(XORENC_STAGE_ARGON2) + XORenc_memory_footprint(XORENC_STAGE_SCRYPT);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_memory_limit:
+
+		Get memory limit of control group (cgroup v2 'memory.max' or v1
+		'memory.limit_in_bytes') the process runs in.
+
+	Return value:
+
+		Returns limit (in bytes), or 0 if there is no limit.
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_memory_limit() {
+
+	const char* FILES[] = { "/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes", NULL };
+	char        value[32];
+	size_t      lpp0;
+
+	for (lpp0=0; FILES[lpp0] != NULL; lpp0++) {
+		FILE* fd0 = fopen(FILES[lpp0], "r");
+
+		if (fd0 == NULL) {
+			continue;
+		}
+
+		char* r = fgets(value, sizeof(value), fd0);
+
+		fclose(fd0);
+
+		// "max" (v2) and huge values (v1) mean no limit
+		if ((r != NULL) && (value[0] >= '0') && (value[0] <= '9')) {
+			unsigned long long limit = strtoull(value, NULL, 10);
+
+			return (limit < ((unsigned long long)1 << 62)) ? (size_t)limit : 0;
+		}
+
+		return 0;
+	}
+
+	return 0;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_io_size:
+
+		Get size of read/write requests suited to a file descriptor. It is independent of
+		'XORENC_FILE_BLOCK_SIZE': the streaming context cuts keystream blocks out of any
+		buffer, so output does not depend on it.
+
+		Regular files and block devices get large requests, rounded up to a multiple of their
+		preferred size ('st_blksize', e.g. stripe width of a RAID array); pipes and sockets get
+		their capacity, so a reader is not kept waiting for a buffer that rarely fills.
+
+	Parameters:
+
+		fd     -> The file descriptor.
+
+		params -> The parameters to be considered ('io_size' overrides the size; with
+		          'bwlimit' it stays at one block, so bursts are not made larger).
+
+	Return value:
+
+		Returns size (in bytes), at most 'XORENC_IO_SIZE_MAX'.
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_io_size(const int fd, const TXORencParams* params) {
+
+	struct stat fd_stat;
+	size_t      RESULT;
+
+	if ((params != NULL) && (params->io_size > 0)) {
+		return (params->io_size < XORENC_IO_SIZE_MAX) ? params->io_size : XORENC_IO_SIZE_MAX;
+	}
+
+	if ((params != NULL) && (params->bwlimit > 0)) {
+		return XORENC_FILE_BLOCK_SIZE;
+	}
+
+	if (fstat(fd, &fd_stat) != 0) {
+		return XORENC_FILE_BLOCK_SIZE;
+	}
+
+	if ((S_ISREG(fd_stat.st_mode)) || (S_ISBLK(fd_stat.st_mode))) {
+		size_t unit = (fd_stat.st_blksize > 0) ? (size_t)fd_stat.st_blksize : 4096;
+
+		RESULT = ((XORENC_IO_SIZE_FILE + unit - 1) / unit) * unit;
+
+		return (RESULT < XORENC_IO_SIZE_MAX) ? RESULT : XORENC_IO_SIZE_MAX;
+	}
+
+	if (S_ISFIFO(fd_stat.st_mode)) {
+		int capacity = fcntl(fd, F_GETPIPE_SZ);
+
+		if (capacity > 0) {
+			return ((size_t)capacity < XORENC_IO_SIZE_MAX) ? (size_t)capacity : XORENC_IO_SIZE_MAX;
+		}
+	}
+
+	// sockets, terminals and other character devices
+	return XORENC_IO_SIZE_PIPE;
+}
+
+/** ----------------------------------------------------------------
+
+	KDF libraries ('libargon2' and 'libscrypt') are only loaded when
+	the first key is derived, so direct mode never pays for them.
+
+	---------------------------------------------------------------- */
+static pthread_once_t XORenc_kdf_once = PTHREAD_ONCE_INIT;
+
+static int (*XORenc_argon2_ctx)(argon2_context* context, argon2_type type) = NULL;
+static int (*XORenc_libscrypt_scrypt)(const uint8_t* passwd, size_t passwdlen, const uint8_t* salt, size_t saltlen, uint64_t N, uint32_t r, uint32_t p, uint8_t* buf, size_t buflen) = NULL;
+
+static void XORenc_kdf_load_once() {
+
+	const char* ARGON2_NAMES[] = { "libargon2.so.1", "libargon2.so", NULL };
+	const char* SCRYPT_NAMES[] = { "libscrypt.so.0", "libscrypt.so", NULL };
+
+	void*  argon2 = NULL;
+	void*  scrypt = NULL;
+	size_t lpp0;
+
+	for (lpp0=0; (argon2 == NULL) && (ARGON2_NAMES[lpp0] != NULL); lpp0++) {
+		argon2 = dlopen(ARGON2_NAMES[lpp0], RTLD_NOW | RTLD_LOCAL);
+	}
+
+	for (lpp0=0; (scrypt == NULL) && (SCRYPT_NAMES[lpp0] != NULL); lpp0++) {
+		scrypt = dlopen(SCRYPT_NAMES[lpp0], RTLD_NOW | RTLD_LOCAL);
+	}
+
+	if ((argon2 == NULL) || (scrypt == NULL)) {
+		return;
+	}
+
+	*(void**)(&XORenc_argon2_ctx)       = dlsym(argon2, "argon2_ctx");
+	*(void**)(&XORenc_libscrypt_scrypt) = dlsym(scrypt, "libscrypt_scrypt");
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_kdf_load:
+
+		Load KDF libraries ('libargon2' and 'libscrypt'), if not loaded yet.
+
+		Called automatically by the functions that need them; can be called earlier to check
+		that derived mode is available.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_kdf_load() {
+
+	pthread_once(&XORenc_kdf_once, XORenc_kdf_load_once);
+
+	if ((XORenc_argon2_ctx == NULL) || (XORenc_libscrypt_scrypt == NULL)) {
+		return XORENC_ERROR_KDF_LIBRARY;
+	}
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------
+
+	KDF arena, 'Argon2' working memory kept allocated between blocks.
+
+	'Argon2' allocation callbacks take no user data, so the arena of
+	the block being derived is given to them through a thread local
+	pointer, which is only set while 'XORenc_derive_block' runs.
+
+	---------------------------------------------------------------- */
+struct TXORencArena {
+	uint8_t* argon2_memory; // working memory reused by every 'Argon2' call
+	size_t   argon2_size;   // size of 'argon2_memory' (in bytes)
+	bool     argon2_busy;   // 'argon2_memory' is being used right now
+};
+
+static __thread TXORencArena* XORenc_argon2_arena   = NULL;
+static __thread uint32_t      XORenc_argon2_threads = 0;    // threads of 'Argon2' (0->one per lane), see 'TXORencParams.kdf_threads'
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_arena_create:
+
+		Create a KDF arena, to be given to 'TXORencParams.arena'.
+
+		An arena must only be used by one thread at a time; after the first derived block its
+		memory stays allocated (and mapped) until 'XORenc_arena_free'.
+
+	Return value:
+
+		Returns pointer to new arena or NULL if it fails.
+
+	---------------------------------------------------------------------------------------- */
+TXORencArena* XORenc_arena_create() {
+
+	return calloc(1, sizeof(TXORencArena));
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_arena_free:
+
+		Release KDF arena and its memory.
+
+	---------------------------------------------------------------------------------------- */
+void XORenc_arena_free(TXORencArena* arena) {
+
+	if (arena != NULL) {
+		free(arena->argon2_memory);
+		free(arena);
+	}
+}
+
+static int XORenc_argon2_allocate(uint8_t** memory, size_t bytes_to_allocate) {
+
+	TXORencArena* arena = XORenc_argon2_arena;
+
+	if ((arena != NULL) && (arena->argon2_busy == false)) {
+		if (arena->argon2_size < bytes_to_allocate) {
+			free(arena->argon2_memory);
+
+			arena->argon2_memory = malloc(bytes_to_allocate);
+			arena->argon2_size   = (arena->argon2_memory != NULL) ? bytes_to_allocate : 0;
+		}
+
+		if (arena->argon2_memory != NULL) {
+			arena->argon2_busy = true;
+
+			*memory = arena->argon2_memory;
+
+			return ARGON2_OK;
+		}
+	}
+
+	*memory = malloc(bytes_to_allocate);
+
+	return (*memory != NULL) ? ARGON2_OK : ARGON2_MEMORY_ALLOCATION_ERROR;
+}
+
+static void XORenc_argon2_free(uint8_t* memory, size_t bytes_to_allocate) {
+
+	TXORencArena* arena = XORenc_argon2_arena;
+
+	if ((arena != NULL) && (memory == arena->argon2_memory)) {
+		// keep it for the next block ('Argon2' has already wiped it)
+		arena->argon2_busy = false;
+	}
+	else {
+		free(memory);
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_hash_scrypt:
+
+		Generate 'Scrypt' hash of 'XORENC_FILE_BLOCK_SIZE' in length.
+      
+		Result hash is written in binary, as an array of byte in 'hash.data'.
+
+	Parameters:
+
+		pass     -> Input password as string.
+        
+		pass_len -> Length of password string.
+        
+		salt     -> Input salt as string.
+        
+		salt_len -> Length of salt string.
+        
+	Return value:
+
+		Returns derived data as TXORencHash.
+
+	---------------------------------------------------------------------------------------- */
+TXORencHash XORenc_hash_scrypt(	const char*  pass,
+								const size_t pass_len,
+								const char*  salt,
+								const size_t salt_len ) {
+
+	TXORencHash RESULT;
+
+	/* ******* --- XORenc_hash_scrypt --- ******* */
+
+	RESULT.data   = NULL;
+	RESULT.length = XORENC_FILE_BLOCK_SIZE;
+
+	if (XORenc_kdf_load() < 0) {
+		RESULT.length = 0;
+
+		return RESULT;
+	}
+
+	RESULT.data = malloc(XORENC_FILE_BLOCK_SIZE);
+
+	if (RESULT.data == NULL) {
+		RESULT.length = 0;
+
+		return RESULT;
+	}
+	
+	
+	// set 'Scrypt' parameters and generate hash
+	const char*  password        = pass;          // password
+	const size_t password_length = pass_len;      // password length
+	const char*  salt_           = salt;          // salt
+	const size_t salt_length     = salt_len;      // salt length
+	uint64_t     scrypt_N        = XORENC_SCRYPT_N;
+	uint32_t     scrypt_r        = XORENC_SCRYPT_R;
+	uint32_t     scrypt_p        = XORENC_SCRYPT_P;
+	uint8_t*     hash            = RESULT.data;   // where to write result hash
+	const size_t hash_len        = RESULT.length; // length of hash to write
+
+	int r = XORenc_libscrypt_scrypt((uint8_t*)password, password_length, (uint8_t*)salt_, salt_length, scrypt_N, scrypt_r, scrypt_p, hash, hash_len);
+
+	if (r != 0) {
+		// operation failed! :(
+		free(RESULT.data);
+		
+		RESULT.data = NULL;
+		
+		return RESULT;
+	}
+
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_hash_argon2:
+
+		Generate 'Argon2' hash of 'XORENC_FILE_BLOCK_SIZE' in length.
+      
+		Result hash is written in binary, as an array of byte in 'hash.data'.
+
+	Parameters:
+
+		pass     -> Input password as string.
+        
+		pass_len -> Length of password string.
+        
+		salt     -> Input salt as string.
+        
+		salt_len -> Length of salt string.
+        
+	Return value:
+
+		Returns derived data as TXORencHash.
+
+	---------------------------------------------------------------------------------------- */
+TXORencHash XORenc_hash_argon2(	const char*  pass,
+								const size_t pass_len,
+								const char*  salt,
+								const size_t salt_len ) {
+
+	TXORencHash RESULT;
+
+	/* ******* --- XORenc_hash_argon2 --- ******* */
+
+	RESULT.data   = NULL;
+	RESULT.length = XORENC_FILE_BLOCK_SIZE;
+
+	if (XORenc_kdf_load() < 0) {
+		RESULT.length = 0;
+
+		return RESULT;
+	}
+
+	RESULT.data = malloc(XORENC_FILE_BLOCK_SIZE);
+
+	if (RESULT.data == NULL) {
+		RESULT.length = 0;
+	
+		return RESULT;
+	}
+	
+	
+	// set 'Argon2' parameters and generate hash
+	const uint32_t iterations      = XORENC_ARGON2_ITERATIONS;
+	const uint32_t memory          = XORENC_ARGON2_MEMORY;
+	const uint32_t threads         = XORENC_ARGON2_THREADS;
+	const char*    password        = pass;          // password
+	const size_t   password_length = pass_len;      // password length
+	const char*    salt_           = salt;          // salt
+	const size_t   salt_length     = salt_len;      // salt length
+	uint8_t*       hash            = RESULT.data;   // where to write result hash
+	const size_t   hash_len        = RESULT.length; // length of hash to write
+
+	argon2_context context;
+
+	memset(&context, 0, sizeof(context));
+
+	context.out          = hash;
+	context.outlen       = hash_len;
+	context.pwd          = (uint8_t*)password;
+	context.pwdlen       = password_length;
+	context.salt         = (uint8_t*)salt_;
+	context.saltlen      = salt_length;
+	context.t_cost       = iterations;
+	context.m_cost       = memory;
+	context.lanes        = threads;
+	context.threads      = ((XORenc_argon2_threads > 0) && (XORenc_argon2_threads < threads)) ? XORenc_argon2_threads : threads; // lanes (not threads) define the result
+	context.version      = ARGON2_VERSION_NUMBER;
+	context.allocate_cbk = XORenc_argon2_allocate; // same as 'argon2i_hash_raw', but memory may come from an arena
+	context.free_cbk     = XORenc_argon2_free;
+	context.flags        = ARGON2_DEFAULT_FLAGS;
+
+	int r = XORenc_argon2_ctx(&context, Argon2_i);
+		
+	if (r != ARGON2_OK) {
+		// operation failed! :(
+		free(RESULT.data);
+		
+		RESULT.data = NULL;
+		
+		return RESULT;
+	}
+
+
+	return RESULT;
+}
+
+bool XORenc_key_is_byte_sequence(const char* key) {
+
+	// check if input key is of the format: 'XX XX XX...' -> Where 'X' is anything in the range 0-9 and A-F.
+	
+	size_t key_len = strlen(key);
+	size_t lpp0;
+	
+	/* ******* --- XORenc_key_is_byte_sequence --- ******* */
+	
+	if (key_len < 2) {
+		// not a valid byte sequence key
+		return false;
+	}
+	
+	
+	// length of key must be a multiple of 3 or a multiple of 3-1
+	if ((((key_len + 0) % 3) != 0) && (((key_len + 1) % 3) != 0)) {
+		return false;
+	}
+	
+	// single pass: two digits, then a space (last one is optional)
+	for (lpp0=0; lpp0 < key_len; lpp0++) {
+		if ((lpp0 % 3) == 2) {
+			if (key[lpp0] != ' ') {
+				return false;
 			}
+		}
+		else if (((key[lpp0] < '0') || (key[lpp0] > '9')) && ((key[lpp0] < 'A') || (key[lpp0] > 'F'))) {
+			// not a valid byte sequence key
+			return false;
+		}
+	}
+	
+	// survived until here, return 'true' :)
+	return true;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_hex_decode:
+
+		Decode hex digits (upper or lower case, whitespace between them is ignored) in place,
+		in a single pass.
+
+	Parameters:
+
+		data     -> Pointer to hex digits, replaced by the decoded bytes.
+
+		data_len -> Length of 'data' (in bytes).
+
+	Return value:
+
+		Length of decoded bytes, or 'SIZE_MAX' if 'data' is not valid hex.
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_hex_decode(uint8_t* data, const size_t data_len) {
+
+	size_t  RESULT = 0;
+	size_t  digits = 0;
+	uint8_t value  = 0;
+	size_t  lpp0;
+
+	for (lpp0=0; lpp0 < data_len; lpp0++) {
+		uint8_t c = data[lpp0];
+		uint8_t lower = c | 0x20;
+
+		if ((c >= '0') && (c <= '9')) {
+			value = (value << 4) | (c - '0');
+		}
+		else if ((lower >= 'a') && (lower <= 'f')) {
+			value = (value << 4) | (lower - 'a' + 10);
+		}
+		else if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n')) {
+			continue;
+		}
+		else {
+			return SIZE_MAX;
+		}
+
+		// output never overtakes input, so decoding in place is safe
+		if ((++digits % 2) == 0) {
+			data[RESULT++] = value;
+		}
+	}
+
+	return ((digits % 2) == 0) ? RESULT : SIZE_MAX;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_base64_decode:
+
+		Decode base64 (standard alphabet, '=' padding, whitespace is ignored) in place, in a
+		single pass.
+
+	Parameters:
+
+		data     -> Pointer to base64 text, replaced by the decoded bytes.
+
+		data_len -> Length of 'data' (in bytes).
+
+	Return value:
+
+		Length of decoded bytes, or 'SIZE_MAX' if 'data' is not valid base64.
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_base64_decode(uint8_t* data, const size_t data_len) {
+
+	size_t   RESULT  = 0;
+	size_t   symbols = 0;
+	size_t   padding = 0;
+	uint32_t value   = 0;
+	size_t   lpp0;
+
+	for (lpp0=0; lpp0 < data_len; lpp0++) {
+		uint8_t c = data[lpp0];
+		uint8_t v;
+
+		if ((c >= 'A') && (c <= 'Z')) {
+			v = c - 'A';
+		}
+		else if ((c >= 'a') && (c <= 'z')) {
+			v = c - 'a' + 26;
+		}
+		else if ((c >= '0') && (c <= '9')) {
+			v = c - '0' + 52;
+		}
+		else if (c == '+') {
+			v = 62;
+		}
+		else if (c == '/') {
+			v = 63;
+		}
+		else if (c == '=') {
+			padding += 1;
+			v        = 0;
+		}
+		else if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n')) {
+			continue;
+		}
+		else {
+			return SIZE_MAX;
+		}
+
+		if ((padding > 0) && (c != '=')) {
+			// nothing may follow padding
+			return SIZE_MAX;
+		}
+
+		value = (value << 6) | v;
+
+		// every 4 symbols are 3 bytes, output never overtakes input
+		if ((++symbols % 4) == 0) {
+			data[RESULT++] = (uint8_t)(value >> 16);
+			data[RESULT++] = (uint8_t)(value >> 8);
+			data[RESULT++] = (uint8_t)value;
+			value          = 0;
+		}
+	}
+
+	if (((symbols % 4) != 0) || (padding > 2)) {
+		return SIZE_MAX;
+	}
+
+	return RESULT - padding;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_key_load:
+
+		Load a key from file or command line (option '--key, -k') and returns it.
+      
+		This function can be used to load keys when encrypting with 'XORenc_encrypt_direct'.
+
+	Parameters:
+
+		str       -> Refers to path to a key file or key in the format:
+        
+			'XX XX XX...'
+                 
+			Where 'X' is anything in the range 0-9 and A-F.
+        
+		block     -> Block of key to be retrieved (0->whole key is loaded; >=1->first/Nth block).
+        
+		block_len -> The actual length of the block or the key.
+        
+	Return value:
 			
-			
-			lpp1 += 1;
-			lpp0 += 2; // skip space
+		The pointer to key data of size 'block_len'.
+				
+		Returns 'NULL' if it fails.
+
+	---------------------------------------------------------------------------------------- */
+TXORencKey XORenc_key_load(const char* str, const size_t block) {
+
+	TXORencKey  RESULT = { NULL, 0 };
+	FILE*       fd0;
+	struct stat key_stat;
+	// loop vars
+	size_t lpp0, lpp1;
+	
+	/* ******* --- XORenc_key_load --- ******* */
+	
+	// open key file directly (no 'access' before it); anything that can not be opened may be a byte sequence
+	fd0 = fopen(str, "rb");
+
+	if (fd0 != NULL) {
+		// file exists, it is key file :)
+		uint64_t offset   = (uint64_t)XORENC_FILE_BLOCK_SIZE * block;
+		size_t   capacity = XORENC_FILE_BLOCK_SIZE;
+
+		if ((fstat(fileno(fd0), &key_stat) == 0) && (S_ISREG(key_stat.st_mode))) {
+			// buffer is sized to what is left of the file, up to a block
+			uint64_t left = ((uint64_t)key_stat.st_size > offset) ? (uint64_t)key_stat.st_size - offset : 0;
+
+			capacity = (left < XORENC_FILE_BLOCK_SIZE) ? (size_t)left : XORENC_FILE_BLOCK_SIZE;
+		}
+
+		if (capacity > 0) {
+			RESULT.data = malloc(capacity);
+		}
+
+		if ((RESULT.data != NULL) && ((block == 0) || (fseeko(fd0, offset, SEEK_SET) == 0))) {
+			RESULT.length = fread(RESULT.data, 1, capacity, fd0);
+		}
+
+		fclose(fd0);
+
+		if (RESULT.length == 0) {
+			// could not load key (or block) from file
+			free(RESULT.data);
+
+			RESULT.data = NULL;
+		}
+	}
+	else if ((XORenc_key_is_byte_sequence(str) == true) && (block == 0)) {
+		// it is byte sequence of type: 'XX XX XX...'; convert it to binary, in a single pass...
+		size_t   str_len  = strlen(str);
+		uint8_t* key_data = malloc((str_len / 3) + 1);
+		
+		if (key_data == NULL) {
+			return RESULT;
+		}
+		
+		RESULT.data = key_data;
+		
+		for (lpp0=0, lpp1=0; lpp0 + 1 < str_len; lpp0 += 3, lpp1++) {
+			// high and low order digits (validated above, 'A'-'F' or '0'-'9')
+			key_data[lpp1]  = ((str[lpp0]   >= 'A') ? (str[lpp0]   - 0x37) : (str[lpp0]   - 0x30)) << 4;
+			key_data[lpp1] |= ((str[lpp0+1] >= 'A') ? (str[lpp0+1] - 0x37) : (str[lpp0+1] - 0x30));
 		}
 		
 		RESULT.length = lpp1;
 	}
-	else {
-		// couldn't find a way to load key
-		RESULT.length = 0;
-		
-		free(RESULT.data);
-		
-		return RESULT;
+
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_xor:
+
+		Perform encryption/decryption of input data.
+
+		The key given must be of the same length as the input data.
+
+		The input data is simply XOR'ed with the input key.
+
+	Parameters:
+
+		data     -> Pointer to data to be encrypted/decrypted.
+
+		data_len -> Length of input data (in bytes).
+
+		key      -> Pointer to key to be used for encryption.
+
+		key_len  -> Length of input key (in bytes).
+
+	---------------------------------------------------------------------------------------- */
+void XORenc_encrypt_xor(uint8_t* data, const size_t data_len, const uint8_t* key, const size_t key_len) {
+
+	size_t written_bytes;
+	size_t remaining_bytes;
+	size_t lpp0;
+	
+	if (data_len != key_len) {
+		return;
+	}
+	
+	written_bytes = 0;
+	
+	// xor data in qword blocks (faster than byte by byte)
+	if (data_len >= 8) {
+		uint64_t* data_q = ((uint64_t*) data);
+		uint64_t* key_q  = ((uint64_t*) key);
+		
+		for (lpp0=0; lpp0 < (data_len / 8); lpp0++) {
+			data_q[lpp0] ^= key_q[lpp0];
+			
+			written_bytes += 8;
+		}
+	}
+
+
+	remaining_bytes = data_len - written_bytes;
+
+
+	// write remaining bytes if total length is not multiple of 8
+	if (remaining_bytes > 0) {
+		for (lpp0=0; lpp0 < remaining_bytes; lpp0++) {
+			data[lpp0+written_bytes] ^= key[lpp0+written_bytes];
+		}
+	}
+}
+
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_xor_multi:
+
+		Perform encryption/decryption of input data with several keys at once.
+
+		Data is processed in pieces small enough to stay in L1 cache while every key is XOR'ed
+		into them, so data is read and written from memory only once however many keys there are.
+
+	Parameters:
+
+		data      -> Pointer to data to be encrypted/decrypted.
+
+		data_len  -> Length of input data (in bytes), every key must be (at least) this long.
+
+		keys      -> Pointers to keys to be used for encryption.
+
+		key_count -> Number of items in 'keys'.
+
+	---------------------------------------------------------------------------------------- */
+void XORenc_encrypt_xor_multi(uint8_t* data, const size_t data_len, const uint8_t* const* keys, const size_t key_count) {
+
+	const size_t PIECE_SIZE = 4096;
+	size_t       piece_len;
+	size_t       lpp0, lpp1;
+
+	for (lpp0=0; lpp0 < data_len; lpp0 += piece_len) {
+		piece_len = ((data_len - lpp0) < PIECE_SIZE) ? (data_len - lpp0) : PIECE_SIZE;
+
+		for (lpp1=0; lpp1 < key_count; lpp1++) {
+			XORenc_encrypt_xor(&data[lpp0], piece_len, &keys[lpp1][lpp0], piece_len);
+		}
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_chacha20:
+
+		Generate ChaCha20 keystream (original variant: 64 bit block counter, 64 bit nonce),
+		used to expand a random seed into keys, see 'XORenc_generate_key'.
+
+		Any block can be generated on its own, so a long keystream can be split between
+		threads by block counter.
+
+	Parameters:
+
+		key     -> Key (32 bytes).
+
+		nonce   -> Nonce.
+
+		counter -> Number of first block (64 bytes) to generate.
+
+		out     -> Where to store keystream.
+
+		out_len -> Length of keystream to generate (in bytes).
+
+	---------------------------------------------------------------------------------------- */
+#define XORENC_CHACHA_ROTL(v,n) (((v) << (n)) | ((v) >> (32 - (n))))
+#define XORENC_CHACHA_QR(a,b,c,d) \
+	a += b; d ^= a; d = XORENC_CHACHA_ROTL(d,16); \
+	c += d; b ^= c; b = XORENC_CHACHA_ROTL(b,12); \
+	a += b; d ^= a; d = XORENC_CHACHA_ROTL(d, 8); \
+	c += d; b ^= c; b = XORENC_CHACHA_ROTL(b, 7);
+
+void XORenc_chacha20(const uint8_t* key, const uint64_t nonce, uint64_t counter, uint8_t* out, const size_t out_len) {
+
+	uint32_t state[16], x[16];
+	uint8_t  block[64];
+	size_t   done = 0;
+	size_t   lpp0;
+
+	state[0] = 0x61707865; // "expand 32-byte k"
+	state[1] = 0x3320646e;
+	state[2] = 0x79622d32;
+	state[3] = 0x6b206574;
+
+	for (lpp0=0; lpp0 < 8; lpp0++) {
+		state[4 + lpp0] = (uint32_t)key[lpp0*4] | ((uint32_t)key[lpp0*4 + 1] << 8) | ((uint32_t)key[lpp0*4 + 2] << 16) | ((uint32_t)key[lpp0*4 + 3] << 24);
+	}
+
+	state[14] = (uint32_t)nonce;
+	state[15] = (uint32_t)(nonce >> 32);
+
+	while (done < out_len) {
+		state[12] = (uint32_t)counter;
+		state[13] = (uint32_t)(counter >> 32);
+
+		memcpy(x, state, sizeof(x));
+
+		for (lpp0=0; lpp0 < 10; lpp0++) {
+			// column rounds
+			XORENC_CHACHA_QR(x[0], x[4], x[ 8], x[12]);
+			XORENC_CHACHA_QR(x[1], x[5], x[ 9], x[13]);
+			XORENC_CHACHA_QR(x[2], x[6], x[10], x[14]);
+			XORENC_CHACHA_QR(x[3], x[7], x[11], x[15]);
+			// diagonal rounds
+			XORENC_CHACHA_QR(x[0], x[5], x[10], x[15]);
+			XORENC_CHACHA_QR(x[1], x[6], x[11], x[12]);
+			XORENC_CHACHA_QR(x[2], x[7], x[ 8], x[13]);
+			XORENC_CHACHA_QR(x[3], x[4], x[ 9], x[14]);
+		}
+
+		for (lpp0=0; lpp0 < 16; lpp0++) {
+			uint32_t v = x[lpp0] + state[lpp0];
+
+			block[lpp0*4]     = (uint8_t)v;
+			block[lpp0*4 + 1] = (uint8_t)(v >> 8);
+			block[lpp0*4 + 2] = (uint8_t)(v >> 16);
+			block[lpp0*4 + 3] = (uint8_t)(v >> 24);
+		}
+
+		lpp0 = ((out_len - done) < sizeof(block)) ? (out_len - done) : sizeof(block);
+
+		memcpy(&out[done], block, lpp0);
+
+		done    += lpp0;
+		counter += 1;
+	}
+
+	explicit_bzero(x, sizeof(x));
+	explicit_bzero(block, sizeof(block));
+	explicit_bzero(state, sizeof(state));
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_crc32c:
+
+		Calculate CRC32C (Castagnoli) of data, continuing from the CRC of data before it (0 to
+		start). Uses the CRC32 instruction when the CPU has it (SSE4.2), a table otherwise.
+
+	Parameters:
+
+		crc      -> CRC of preceding data, or 0.
+
+		data     -> Pointer to data.
+
+		data_len -> Length of data (in bytes).
+
+	Return value:
+
+		CRC of preceding data and 'data'.
+
+	---------------------------------------------------------------------------------------- */
+static pthread_once_t XORenc_crc32c_once = PTHREAD_ONCE_INIT;
+static uint32_t       XORenc_crc32c_table[256];
+static bool           XORenc_crc32c_hw   = false;
+
+static void XORenc_crc32c_init() {
+
+	uint32_t lpp0, lpp1;
+
+	for (lpp0=0; lpp0 < 256; lpp0++) {
+		uint32_t crc = lpp0;
+
+		for (lpp1=0; lpp1 < 8; lpp1++) {
+			crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78 : 0);
+		}
+
+		XORenc_crc32c_table[lpp0] = crc;
+	}
+
+#if defined(__x86_64__)
+	XORenc_crc32c_hw = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t XORenc_crc32c_sse42(uint32_t crc, const uint8_t* data, size_t data_len) {
+
+	uint64_t crc_q = crc;
+	uint64_t value;
+
+	while (data_len >= 8) {
+		memcpy(&value, data, 8);
+
+		crc_q     = _mm_crc32_u64(crc_q, value);
+		data     += 8;
+		data_len -= 8;
+	}
+
+	crc = (uint32_t)crc_q;
+
+	while (data_len > 0) {
+		crc       = _mm_crc32_u8(crc, *data);
+		data     += 1;
+		data_len -= 1;
+	}
+
+	return crc;
+}
+#endif
+
+uint32_t XORenc_crc32c(uint32_t crc, const uint8_t* data, const size_t data_len) {
+
+	size_t lpp0;
+
+	pthread_once(&XORenc_crc32c_once, XORenc_crc32c_init);
+
+	crc = ~crc;
+
+#if defined(__x86_64__)
+	if (XORenc_crc32c_hw) {
+		return ~XORenc_crc32c_sse42(crc, data, data_len);
+	}
+#endif
+
+	for (lpp0=0; lpp0 < data_len; lpp0++) {
+		crc = XORenc_crc32c_table[(crc ^ data[lpp0]) & 0xff] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+/** ----------------------------------------------------------------
+
+	Compression libraries ('libzstd' and 'liblz4') are loaded at run
+	time, like the KDF libraries; only the few functions below are
+	used, so their headers are not needed.
+
+	---------------------------------------------------------------- */
+static pthread_once_t XORenc_compress_once = PTHREAD_ONCE_INIT;
+
+static size_t (*XORenc_ZSTD_compress)(void* dst, size_t dst_cap, const void* src, size_t src_len, int level) = NULL;
+static size_t (*XORenc_ZSTD_decompress)(void* dst, size_t dst_cap, const void* src, size_t src_len)          = NULL;
+static size_t (*XORenc_ZSTD_compressBound)(size_t src_len)                                                     = NULL;
+static unsigned (*XORenc_ZSTD_isError)(size_t code)                                                            = NULL;
+static int (*XORenc_LZ4_compress_default)(const char* src, char* dst, int src_len, int dst_cap)                = NULL;
+static int (*XORenc_LZ4_decompress_safe)(const char* src, char* dst, int src_len, int dst_cap)                 = NULL;
+static int (*XORenc_LZ4_compressBound)(int src_len)                                                            = NULL;
+
+static const int XORENC_ZSTD_LEVEL = 3; // 'zstd' default level
+
+static void XORenc_compress_load_once() {
+
+	const char* ZSTD_NAMES[] = { "libzstd.so.1", "libzstd.so", NULL };
+	const char* LZ4_NAMES[]  = { "liblz4.so.1", "liblz4.so", NULL };
+
+	void*  zstd = NULL;
+	void*  lz4  = NULL;
+	size_t lpp0;
+
+	for (lpp0=0; (zstd == NULL) && (ZSTD_NAMES[lpp0] != NULL); lpp0++) {
+		zstd = dlopen(ZSTD_NAMES[lpp0], RTLD_NOW | RTLD_LOCAL);
+	}
+
+	for (lpp0=0; (lz4 == NULL) && (LZ4_NAMES[lpp0] != NULL); lpp0++) {
+		lz4 = dlopen(LZ4_NAMES[lpp0], RTLD_NOW | RTLD_LOCAL);
 	}
 
+	if (zstd != NULL) {
+		*(void**)(&XORenc_ZSTD_compress)      = dlsym(zstd, "ZSTD_compress");
+		*(void**)(&XORenc_ZSTD_decompress)    = dlsym(zstd, "ZSTD_decompress");
+		*(void**)(&XORenc_ZSTD_compressBound) = dlsym(zstd, "ZSTD_compressBound");
+		*(void**)(&XORenc_ZSTD_isError)       = dlsym(zstd, "ZSTD_isError");
+	}
 
-	return RESULT;
+	if (lz4 != NULL) {
+		*(void**)(&XORenc_LZ4_compress_default) = dlsym(lz4, "LZ4_compress_default");
+		*(void**)(&XORenc_LZ4_decompress_safe)  = dlsym(lz4, "LZ4_decompress_safe");
+		*(void**)(&XORenc_LZ4_compressBound)    = dlsym(lz4, "LZ4_compressBound");
+	}
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_encrypt_xor:
+	XORenc_compress_load:
 
-		Perform encryption/decryption of input data.
+		Load library of a compression algorithm ('libzstd' or 'liblz4'), if not loaded yet.
 
-		The key given must be of the same length as the input data.
+	Parameters:
 
-		The input data is simply XOR'ed with the input key.
+		algo -> The compression algorithm.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_compress_load(const TXORencCompression algo) {
+
+	pthread_once(&XORenc_compress_once, XORenc_compress_load_once);
+
+	switch (algo) {
+		case XORENC_COMPRESS_ZSTD:
+			return ((XORenc_ZSTD_compress != NULL) && (XORenc_ZSTD_decompress != NULL) && (XORenc_ZSTD_compressBound != NULL) && (XORenc_ZSTD_isError != NULL)) ?
+					XORENC_OK : XORENC_ERROR_COMPRESS_LIBRARY;
+
+		case XORENC_COMPRESS_LZ4:
+			return ((XORenc_LZ4_compress_default != NULL) && (XORenc_LZ4_decompress_safe != NULL) && (XORenc_LZ4_compressBound != NULL)) ?
+					XORENC_OK : XORENC_ERROR_COMPRESS_LIBRARY;
+
+		default:
+			return XORENC_ERROR_PARAMS;
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_compress_bound:
+
+		Returns the largest size 'src_len' bytes can take once compressed (library must be
+		loaded, see 'XORenc_compress_load').
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_compress_bound(const TXORencCompression algo, const size_t src_len) {
+
+	if (algo == XORENC_COMPRESS_ZSTD) {
+		return XORenc_ZSTD_compressBound(src_len);
+	}
+
+	return (size_t)XORenc_LZ4_compressBound((int)src_len);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_compress:
+
+		Compress data (library must be loaded, see 'XORenc_compress_load').
 
 	Parameters:
 
-		data     -> Pointer to data to be encrypted/decrypted.
+		algo    -> The compression algorithm.
 
-		data_len -> Length of input data (in bytes).
+		src     -> Pointer to data.
 
-		key      -> Pointer to key to be used for encryption.
+		src_len -> Length of data (in bytes, less than 2 GiB).
 
-		key_len  -> Length of input key (in bytes).
+		dst     -> Where to store compressed data.
+
+		dst_cap -> Size of 'dst' (see 'XORenc_compress_bound').
+
+	Return value:
+
+		Length of compressed data, SIZE_MAX on failure.
 
 	---------------------------------------------------------------------------------------- */
-void XORenc_encrypt_xor(uint8_t* data, const size_t data_len, const uint8_t* key, const size_t key_len) {
+size_t XORenc_compress(const TXORencCompression algo, const uint8_t* src, const size_t src_len, uint8_t* dst, const size_t dst_cap) {
 
-	size_t written_bytes;
-	size_t remaining_bytes;
-	size_t lpp0;
-	
-	if (data_len != key_len) {
-		return;
+	if (algo == XORENC_COMPRESS_ZSTD) {
+		size_t r = XORenc_ZSTD_compress(dst, dst_cap, src, src_len, XORENC_ZSTD_LEVEL);
+
+		return (XORenc_ZSTD_isError(r)) ? SIZE_MAX : r;
 	}
-	
-	written_bytes = 0;
-	
-	// xor data in qword blocks (faster than byte by byte)
-	if (data_len >= 8) {
-		uint64_t* data_q = ((uint64_t*) data);
-		uint64_t* key_q  = ((uint64_t*) key);
-		
-		for (lpp0=0; lpp0 < (data_len / 8); lpp0++) {
-			data_q[lpp0] ^= key_q[lpp0];
-			
-			written_bytes += 8;
-		}
+	else {
+		int r = XORenc_LZ4_compress_default((const char*)src, (char*)dst, (int)src_len, (int)dst_cap);
+
+		return (r <= 0) ? SIZE_MAX : (size_t)r;
 	}
+}
 
+/** ----------------------------------------------------------------------------------------
 
-	remaining_bytes = data_len - written_bytes;
+	XORenc_decompress:
 
+		Decompress data made by 'XORenc_compress' (library must be loaded).
 
-	// write remaining bytes if total length is not multiple of 8
-	if (remaining_bytes > 0) {
-		for (lpp0=0; lpp0 < remaining_bytes; lpp0++) {
-			data[lpp0+written_bytes] ^= key[lpp0+written_bytes];
-		}
+	Parameters:
+
+		algo    -> The compression algorithm.
+
+		src     -> Pointer to compressed data.
+
+		src_len -> Length of compressed data (in bytes).
+
+		dst     -> Where to store data.
+
+		dst_cap -> Size of 'dst'.
+
+	Return value:
+
+		Length of data, SIZE_MAX if compressed data is invalid or does not fit in 'dst'.
+
+	---------------------------------------------------------------------------------------- */
+size_t XORenc_decompress(const TXORencCompression algo, const uint8_t* src, const size_t src_len, uint8_t* dst, const size_t dst_cap) {
+
+	if (algo == XORENC_COMPRESS_ZSTD) {
+		size_t r = XORenc_ZSTD_decompress(dst, dst_cap, src, src_len);
+
+		return (XORenc_ZSTD_isError(r)) ? SIZE_MAX : r;
+	}
+	else {
+		int r = XORenc_LZ4_decompress_safe((const char*)src, (char*)dst, (int)src_len, (int)dst_cap);
+
+		return (r < 0) ? SIZE_MAX : (size_t)r;
 	}
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_encrypt_derived_next:
+	XORenc_md5_pair:
 
-		Encrypts second or higher block of data (using derived key from 'key').
+		Generate 'md5sum' normal and inverted (every bit flipped) of input data, as strings.
 
 	Parameters:
 
-		last_md5 -> Pair of md5sum (normal:inverted) from previous block to be used as salt for generation of this block.
+		data     -> Pointer to input data.
 
-		data     -> Pointer to data to be encrypted.
+		data_len -> Length of input data (in bytes).
+
+		md5sum[] -> Where to store 'md5sum' normal and inverted (at least 33 bytes in length each).
+
+	---------------------------------------------------------------------------------------- */
+static void XORenc_md5_pair(const uint8_t* data, const size_t data_len, char* md5sum[]) {
+
+	uint8_t md5_b[16];
+	size_t  lpp0;
+
+	XORenc_md5(data, data_len, md5_b, md5sum[0]);
+
+	md5sum[0][16*2] = '\0';
+
+	for (lpp0=0; lpp0 < 16; lpp0++) {
+		// invert the bits
+		md5_b[lpp0] = ~md5_b[lpp0];
+	}
+
+	// inverted md5sum to string
+	for (lpp0=0; lpp0 < 16; lpp0++) {
+		char* tmp = XORenc_int2hex(md5_b[lpp0], 2, true);
+
+		md5sum[1][(lpp0*2)+0] = tmp[0];
+		md5sum[1][(lpp0*2)+1] = tmp[1];
+
+		free(tmp);
+	}
+
+	md5sum[1][16*2] = '\0';
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_derive_block:
+
+		Generate derived key (XOR'ed Argon2<->Scrypt data) of one block, 'XORENC_FILE_BLOCK_SIZE' in length.
+
+		The derived key does not depend on the data being encrypted, only on the password and on
+		the 'md5sum' pair of the previous block (the first block uses the 'md5sum' pair of the password).
+
+	Parameters:
 
-		data_len -> Length of input 'data', in bytes (maximum=XORENC_FILE_BLOCK_SIZE).
-				
 		key      -> The key used to generate derived data (as string).
-				
+
 		key_len  -> The length of input 'key'.
-        
-		md5sum[] -> Where to store 'md5sum' normal and inverted of processed (XOR'ed with Argon2<->Scrypt) derived data (at least 33 bytes in length).
+
+		last_md5 -> Pair of md5sum (normal:inverted) from previous block, or NULL for the first block.
+
+		md5sum[] -> Where to store 'md5sum' normal and inverted of generated derived key (at least 33 bytes in length), may be NULL.
+
+		params   -> The parameters to be applied (KDF arena...), may be NULL.
 
 	Return value:
 
-		Returns 0 or positive value on success.
+		Returns derived key as TXORencHash ('data' is NULL if it fails).
 
 	---------------------------------------------------------------------------------------- */
-int XORenc_encrypt_derived_next(char* last_md5[], uint8_t* data, const size_t data_len, const char* key, const size_t key_len, char* md5sum[]) {
+TXORencHash XORenc_derive_block(const char* key, const size_t key_len, char* last_md5[], char* md5sum[], const TXORencParams* params) {
 
-	size_t lpp0;
-	
-	if (data_len > XORENC_FILE_BLOCK_SIZE) {
-		return -1;
+	char          key_md5_1s[(16*2)+1]; // md5 digest of key as string
+	char          key_md5_2s[(16*2)+1]; // inverted md5 digest of key as string
+	char*         key_md5[2] = { key_md5_1s, key_md5_2s };
+	TXORencHash   dkey_1, dkey_2;
+	uint64_t      t0;
+
+	if (last_md5 == NULL) {
+		// first block, salt comes from the key itself
+		t0 = XORenc_stats_begin(params, XORENC_STAGE_MD5);
+
+		XORenc_md5_pair((const uint8_t*)key, key_len, key_md5);
+
+		XORenc_stats_end(params, XORENC_STAGE_MD5, t0);
+
+		last_md5 = key_md5;
 	}
-	
+
 	// generate derived data (Argon2, Scrypt), from password+salt+md5sum_(1, 2)
-	char* final_salt  = calloc(1, 256);
-	char* final_salt2 = calloc(1, 256);
-  			
+	char final_salt[256]  = { 0 };
+	char final_salt2[256] = { 0 };
+
 	if ((strlen(XORENC_SALT) + strlen(last_md5[0])) < 256) {
 		strcat(final_salt, XORENC_SALT);
 		strcat(final_salt, last_md5[0]);
-  				
+
 		strcat(final_salt2, XORENC_SALT);
 		strcat(final_salt2, last_md5[1]);
 	}
@@ -620,89 +1763,81 @@ int XORenc_encrypt_derived_next(char* last_md5[], uint8_t* data, const size_t da
 		fprintf(stderr, "Warning: Buffer overflow! Consider decreasing XORENC_SALT length or increase buffer. (0xe041bd206b89ad10)");
 	}
 
-	TXORencHash dkey_1 = XORenc_hash_argon2(key, key_len, final_salt, strlen(final_salt));
-	TXORencHash dkey_2 = XORenc_hash_scrypt(key, key_len, final_salt2, strlen(final_salt2));
+	XORenc_argon2_arena   = (params != NULL) ? params->arena : NULL;
+	XORenc_argon2_threads = (params != NULL) ? params->kdf_threads : 0;
+
+	t0     = XORenc_stats_begin(params, XORENC_STAGE_ARGON2);
+	dkey_1 = XORenc_hash_argon2(key, key_len, final_salt, strlen(final_salt));
+
+	XORenc_stats_end(params, XORENC_STAGE_ARGON2, t0);
+
+	t0     = XORenc_stats_begin(params, XORENC_STAGE_SCRYPT);
+	dkey_2 = XORenc_hash_scrypt(key, key_len, final_salt2, strlen(final_salt2));
+
+	XORenc_stats_end(params, XORENC_STAGE_SCRYPT, t0);
+
+	XORenc_argon2_arena   = NULL;
+	XORenc_argon2_threads = 0;
 
-	free(final_salt);
-	free(final_salt2);
-  
 	if ((dkey_1.data == NULL) || (dkey_2.data == NULL)) {
 		if (dkey_1.data != NULL) {
-			free(dkey_1.data);
+			explicit_bzero(dkey_1.data, dkey_1.length);
 		}
 
 		if (dkey_2.data != NULL) {
-			free(dkey_2.data);
+			explicit_bzero(dkey_2.data, dkey_2.length);
 		}
 
-		return -1;
+		free(dkey_1.data);
+		free(dkey_2.data);
+
+		dkey_1.data   = NULL;
+		dkey_1.length = 0;
+
+		return dkey_1;
 	}
 
 	// XOR derived data from Argon2 with Scrypt's
 	XORenc_encrypt_xor(dkey_1.data, dkey_1.length, dkey_2.data, dkey_2.length);
 
+	// wiped before being freed, like every buffer holding key material ('memset' may be optimized away)
+	explicit_bzero(dkey_2.data, dkey_2.length);
 	free(dkey_2.data);
-  
-  
-	// #4 - Encrypt input data :)
-	XORenc_encrypt_xor(data, data_len, dkey_1.data, data_len);
-  
-  
-	// generate md5sum(s) of generated and processed derived data for this block
+
+	// generate md5sum(s) of processed (XOR'ed Argon2<->Scrypt) derived data for this block
 	if ((md5sum != NULL) && ((md5sum[0] != NULL) && (md5sum[1] != NULL))) {
-		// generate 'md5sum' for processed (XOR'ed Argon2<->Scrypt) derived data
-		uint8_t* md5_1b = calloc(1, 16);
-		char*    md5_1s = calloc(1, (16*2)+1);
-		char*    md5_2s = calloc(1, (16*2)+1);
-		
-		XORenc_md5(dkey_1.data, dkey_1.length, md5_1b, md5_1s);
-		
-		for (lpp0=0; lpp0 < 16; lpp0++) {
-			// invert the bits
-			md5_1b[lpp0] = ~md5_1b[lpp0];
-		}
-		
-		// inverted md5sum to string
-		for (lpp0=0; lpp0 < 16; lpp0++) {
-			char* tmp = XORenc_int2hex(md5_1b[lpp0], 2, true);
+		t0 = XORenc_stats_begin(params, XORENC_STAGE_MD5);
 
-			md5_2s[(lpp0*2)+0] = tmp[0];
-			md5_2s[(lpp0*2)+1] = tmp[1];
+		XORenc_md5_pair(dkey_1.data, dkey_1.length, md5sum);
 
-			free(tmp);
-		}
-  	
-		// copy final md5sum(s) to their respective destination
-		memcpy(md5sum[0], md5_1s, strlen(md5_1s)+1); // copy everything, including null terminator
-		memcpy(md5sum[1], md5_2s, strlen(md5_2s)+1); // copy everything, including null terminator
+		XORenc_stats_end(params, XORENC_STAGE_MD5, t0);
+	}
 
-		// free used resources		
-		free(md5_2s);
-		free(md5_1s);
-		free(md5_1b);
+	if ((params != NULL) && (params->stats != NULL)) {
+		params->stats->derived_blocks += 1;
 	}
-  
-  
-	free(dkey_1.data);
-  
-	return 0;
+
+
+	return dkey_1;
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_encrypt_derived_first:
+	XORenc_encrypt_derived_next:
 
-		Encrypts first block of data (using derived key from 'key').
+		Encrypts second or higher block of data (using derived key from 'key').
 
 	Parameters:
 
+		last_md5 -> Pair of md5sum (normal:inverted) from previous block to be used as salt for generation of this block.
+
 		data     -> Pointer to data to be encrypted.
 
 		data_len -> Length of input 'data', in bytes (maximum=XORENC_FILE_BLOCK_SIZE).
-
-		key      -> Pointer to key string (used to generate derived data).
-
-		key_len  -> Length of input 'key'.
+				
+		key      -> The key used to generate derived data (as string).
+				
+		key_len  -> The length of input 'key'.
         
 		md5sum[] -> Where to store 'md5sum' normal and inverted of processed (XOR'ed with Argon2<->Scrypt) derived data (at least 33 bytes in length).
 
@@ -711,120 +1846,67 @@ int XORenc_encrypt_derived_next(char* last_md5[], uint8_t* data, const size_t da
 		Returns 0 or positive value on success.
 
 	---------------------------------------------------------------------------------------- */
-int XORenc_encrypt_derived_first(uint8_t* data, const size_t data_len, const char* key, const size_t key_len, char* md5sum[]) {
+int XORenc_encrypt_derived_next(char* last_md5[], uint8_t* data, const size_t data_len, const char* key, const size_t key_len, char* md5sum[]) {
 
-	size_t lpp0;
-	
-	if (data_len > XORENC_FILE_BLOCK_SIZE) {
+	if ((data_len > XORENC_FILE_BLOCK_SIZE) || (last_md5 == NULL)) {
 		return -1;
 	}
 
-	// #1 :)
-	uint8_t* key_md5_1b = calloc(1, 16);       // md5 digest as raw bytes
-	char*    key_md5_1s = calloc(1, (16*2)+1); // md5 digest as string
-
-	uint8_t* key_md5_2b = calloc(1, 16);       // md5 digest -> 2 <- as raw bytes
-	char*    key_md5_2s = calloc(1, (16*2)+1); // md5 digest -> 2 <- as string
+	TXORencHash dkey = XORenc_derive_block(key, key_len, last_md5, md5sum, NULL);
 
-	XORenc_md5((uint8_t*)key, key_len, key_md5_1b, key_md5_1s);
-
-	// generate inverted md5sum of original
-	memcpy(key_md5_2b, key_md5_1b, 16);
-
-	for (lpp0=0; lpp0 < 16; lpp0++) {
-		// invert the bits
-		key_md5_2b[lpp0] = ~key_md5_2b[lpp0];
+	if (dkey.data == NULL) {
+		return -1;
 	}
 
-	// inverted md5sum to string
-	for (lpp0=0; lpp0 < 16; lpp0++) {
-		char* tmp = XORenc_int2hex(key_md5_2b[lpp0], 2, true);
-
-		key_md5_2s[(lpp0*2)+0] = tmp[0];
-		key_md5_2s[(lpp0*2)+1] = tmp[1];
+	// Encrypt input data :)
+	XORenc_encrypt_xor(data, data_len, dkey.data, data_len);
 
-		free(tmp);
-	}
+	explicit_bzero(dkey.data, dkey.length);
+	free(dkey.data);
+  
+	return 0;
+}
 
-	// generate derived data (Argon2), from password+salt+md5sum_1s
-	char* final_salt  = calloc(1, 256);
-	char* final_salt2 = calloc(1, 256);
-  			
-	if ((strlen(XORENC_SALT) + strlen(key_md5_1s)) < 256) {
-		strcat(final_salt, XORENC_SALT);
-		strcat(final_salt, key_md5_1s);
-  				
-		strcat(final_salt2, XORENC_SALT);
-		strcat(final_salt2, key_md5_2s);
-	}
-	else {
-		fprintf(stderr, "Warning: Buffer overflow! Consider decreasing XORENC_SALT length or increase buffer. (0xa594f280c9e2ad60)");
-	}
+/** ----------------------------------------------------------------------------------------
 
-	TXORencHash dkey_1 = XORenc_hash_argon2(key, key_len, final_salt, strlen(final_salt));
-	TXORencHash dkey_2 = XORenc_hash_scrypt(key, key_len, final_salt2, strlen(final_salt2));
+	XORenc_encrypt_derived_first:
 
-	free(final_salt);
-	free(final_salt2);
+		Encrypts first block of data (using derived key from 'key').
 
-	free(key_md5_1b); free(key_md5_1s);
-	free(key_md5_2b); free(key_md5_2s);
+	Parameters:
 
-	if ((dkey_1.data == NULL) || (dkey_2.data == NULL)) {
-		if (dkey_1.data != NULL) {
-			free(dkey_1.data);
-		}
+		data     -> Pointer to data to be encrypted.
 
-		if (dkey_2.data != NULL) {
-			free(dkey_2.data);
-		}
+		data_len -> Length of input 'data', in bytes (maximum=XORENC_FILE_BLOCK_SIZE).
 
-		return -1;
-	}
+		key      -> Pointer to key string (used to generate derived data).
 
-	// XOR derived data from Argon2 with Scrypt's
-	XORenc_encrypt_xor(dkey_1.data, dkey_1.length, dkey_2.data, dkey_2.length);
+		key_len  -> Length of input 'key'.
+        
+		md5sum[] -> Where to store 'md5sum' normal and inverted of processed (XOR'ed with Argon2<->Scrypt) derived data (at least 33 bytes in length).
 
-	free(dkey_2.data);
+	Return value:
 
-	// #2 - Encrypt input data :)
-	XORenc_encrypt_xor(data, data_len, dkey_1.data, data_len);
+		Returns 0 or positive value on success.
 
-	// check if we were told to generate 'md5sum' of XOR'ed key data
-	if ((md5sum != NULL) && ((md5sum[0] != NULL) && (md5sum[1] != NULL))) {
-		// generate 'md5sum' for processed (XOR'ed Argon2<->Scrypt) derived data
-		uint8_t* md5_1b = calloc(1, 16);
-		char*    md5_1s = calloc(1, (16*2)+1);
-		char*    md5_2s = calloc(1, (16*2)+1);
-		
-		XORenc_md5(dkey_1.data, dkey_1.length, md5_1b, md5_1s);
-		
-		for (lpp0=0; lpp0 < 16; lpp0++) {
-			// invert the bits
-			md5_1b[lpp0] = ~md5_1b[lpp0];
-		}
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_derived_first(uint8_t* data, const size_t data_len, const char* key, const size_t key_len, char* md5sum[]) {
 
-		// inverted md5sum to string
-		for (lpp0=0; lpp0 < 16; lpp0++) {
-			char* tmp = XORenc_int2hex(md5_1b[lpp0], 2, true);
+	if (data_len > XORENC_FILE_BLOCK_SIZE) {
+		return -1;
+	}
 
-			md5_2s[(lpp0*2)+0] = tmp[0];
-			md5_2s[(lpp0*2)+1] = tmp[1];
+	TXORencHash dkey = XORenc_derive_block(key, key_len, NULL, md5sum, NULL);
 
-			free(tmp);
-		}
+	if (dkey.data == NULL) {
+		return -1;
+	}
 
-		// copy final md5sum(s) to their respective destination
-		memcpy(md5sum[0], md5_1s, strlen(md5_1s)+1); // copy everything, including null terminator
-		memcpy(md5sum[1], md5_2s, strlen(md5_2s)+1); // copy everything, including null terminator
+	// Encrypt input data :)
+	XORenc_encrypt_xor(data, data_len, dkey.data, data_len);
 
-		// free used resources		
-		free(md5_2s);
-		free(md5_1s);
-		free(md5_1b);
-	}
-	
-	free(dkey_1.data);
+	explicit_bzero(dkey.data, dkey.length);
+	free(dkey.data);
   
 	return 0;
 }
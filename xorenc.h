@@ -0,0 +1,209 @@
+// Warning: Best read if using a monospaced/fixed-width font and tab width of 4.
+#ifndef XORENC_H
+#define XORENC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+//---
+#include <sys/uio.h>
+
+/** ================================================================================
+
+	This file is part of 'XORenc'.
+
+	'XORenc' is a "XOR-based" data encryption tool.
+
+
+	License:
+
+	The MIT License (MIT)
+
+	Copyright (c) 2019 Renan Souza da Motta <renansouzadamotta@yahoo.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	================================================================================ */
+
+/** ----------------------------------------------------------------
+
+	'libxorenc' public interface.
+
+	Library functions never terminate the calling process, they
+	return 0 or a positive value on success and one of the negative
+	'TXORencError' codes below on failure.
+
+	---------------------------------------------------------------- */
+extern const uint32_t XORENC_MIN_PASSWORD_LENGTH;
+extern const size_t   XORENC_FILE_BLOCK_SIZE;
+extern const size_t   XORENC_IO_SIZE_MAX;
+extern const char*    XORENC_SALT;
+
+#define XORENC_MAX_KEYS 16 // maximum number of direct keys (key and 'TXORencParams.extra_keys')
+
+typedef enum {
+	Direct=1,
+	Derived
+} TXORencKeyType;
+
+typedef struct {
+	void*  data;
+	size_t length;
+} TXORencKey;
+
+// encoding of key files
+typedef enum {
+	XORENC_KEY_RAW=0, // used as it is
+	XORENC_KEY_HEX,   // hex digits, whitespace is ignored
+	XORENC_KEY_BASE64 // base64, whitespace is ignored
+} TXORencKeyFormat;
+
+// compression of data before it is encrypted, see 'XORenc_encrypt_compressed'
+typedef enum {
+	XORENC_COMPRESS_NONE=0,
+	XORENC_COMPRESS_ZSTD, // 'zstd', better ratio
+	XORENC_COMPRESS_LZ4   // 'lz4', faster
+} TXORencCompression;
+
+// KDF working memory reused between derived blocks, see 'XORenc_arena_create'
+typedef struct TXORencArena TXORencArena;
+
+// stages of processing timed by 'TXORencStats'
+typedef enum {
+	XORENC_STAGE_READ=0,   // reading input data
+	XORENC_STAGE_KEY_LOAD, // loading direct key (file mapping or byte sequence parsing)
+	XORENC_STAGE_ARGON2,   // 'Argon2' derivation
+	XORENC_STAGE_SCRYPT,   // 'Scrypt' derivation
+	XORENC_STAGE_MD5,      // md5sum chain of derived blocks
+	XORENC_STAGE_XOR,      // XOR'ing data with keystream
+	XORENC_STAGE_WRITE,    // writing output data
+	XORENC_STAGE_COMPRESS, // compressing or decompressing data (see 'XORenc_encrypt_compressed')
+	XORENC_STAGE_COUNT
+} TXORencStage;
+
+// statistics of processing, filled when given to 'TXORencParams.stats' (times are from a monotonic clock)
+typedef struct {
+	uint64_t time_ns[XORENC_STAGE_COUNT]; // time spent in each stage (in nanoseconds)
+	uint64_t calls[XORENC_STAGE_COUNT];   // number of times each stage ran
+	uint64_t total_ns;                    // time spent processing, from start to end (in nanoseconds)
+	uint64_t bytes_in;                    // bytes of input data read
+	uint64_t bytes_out;                   // bytes of output data written
+	uint64_t blocks;                      // blocks ('XORENC_FILE_BLOCK_SIZE') of input data processed (of uncompressed data with compression)
+	uint64_t derived_blocks;              // blocks of derived key generated
+} TXORencStats;
+
+typedef struct {
+	TXORencKeyType   key_type;        // the type of the key
+	TXORencArena*    arena;           // KDF arena to use (optional, NULL allocates memory for every block)
+	TXORencStats*    stats;           // where to add statistics of processing (optional, NULL disables them)
+	FILE*            trace;           // where to write Chrome trace events of every stage (optional, NULL disables them)
+	uint64_t         bwlimit;         // limit of reading and of writing, each (in bytes/sec; optional, 0 disables it)
+	unsigned int     kdf_threads;     // maximum threads of a KDF call (optional, 0 uses all; derived keys do not change)
+	bool             cyclic_key;      // repeat direct key when shorter than the data (optional; weak, only for legacy consumers)
+	const char**     extra_keys;      // further direct keys XOR'ed in the same pass, e.g. one per custodian (optional)
+	size_t           extra_key_count; // number of items in 'extra_keys' (less than 'XORENC_MAX_KEYS')
+	TXORencKeyFormat key_format;      // encoding of key files (optional, raw by default)
+	int              key_fd;          // descriptor of key file, read instead of opening 'key' (optional, 0 disables it; it is not closed)
+	uint64_t         split_size;      // write output file as numbered parts of this size (optional, 0 disables; 'XORenc_encrypt' only)
+	size_t           io_size;         // size of read/write requests (optional, 0 adapts it to the file, see 'XORenc_io_size')
+} TXORencParams;
+
+typedef struct {
+	uint8_t* data;
+	size_t   length;
+} TXORencHash;
+
+typedef enum {
+	XORENC_OK                     =   0,
+	XORENC_ERROR_MEMORY           =  -1, // could not allocate memory
+	XORENC_ERROR_PARAMS           =  -2, // invalid parameters were given
+	XORENC_ERROR_KEY              =  -3, // key could not be loaded
+	XORENC_ERROR_KEY_TOO_SHORT    =  -4, // direct key is shorter than the data
+	XORENC_ERROR_PASSWORD         =  -5, // password is shorter than 'XORENC_MIN_PASSWORD_LENGTH'
+	XORENC_ERROR_KDF              =  -6, // key derivation (Argon2/Scrypt) failed
+	XORENC_ERROR_INPUT            =  -7, // input could not be opened or read
+	XORENC_ERROR_OUTPUT           =  -8, // output could not be created or written
+	XORENC_ERROR_KDF_LIBRARY      =  -9, // KDF library (libargon2/libscrypt) could not be loaded
+	XORENC_ERROR_CHECKSUM         = -10, // checksum of decrypted data does not match (data is corrupted or key is wrong)
+	XORENC_ERROR_COMPRESS_LIBRARY = -11  // compression library (libzstd/liblz4) could not be loaded
+} TXORencError;
+
+// streaming context, see 'XORenc_init'
+typedef struct TXORencContext TXORencContext;
+
+/* ******* --- xorenc.c --- ******* */
+
+char*         XORenc_int2hex(size_t n, unsigned int pad, bool lowercase);
+void          XORenc_md5(const uint8_t* data, const size_t data_len, uint8_t* digest_b, char* digest_s);
+uint64_t      XORenc_clock();
+const char*   XORenc_stage_name(const TXORencStage stage);
+void          XORenc_trace_event(FILE* trace, const char* name, const uint64_t begin, const uint64_t end);
+uint64_t      XORenc_stats_begin(const TXORencParams* params, const TXORencStage stage);
+void          XORenc_stats_end(const TXORencParams* params, const TXORencStage stage, const uint64_t begin);
+size_t        XORenc_memory_footprint(const TXORencStage stage);
+unsigned int  XORenc_kdf_threads();
+size_t        XORenc_memory_derived();
+size_t        XORenc_memory_limit();
+size_t        XORenc_io_size(const int fd, const TXORencParams* params);
+int           XORenc_kdf_load();
+TXORencArena* XORenc_arena_create();
+void          XORenc_arena_free(TXORencArena* arena);
+TXORencHash   XORenc_hash_scrypt(const char* pass, const size_t pass_len, const char* salt, const size_t salt_len);
+TXORencHash   XORenc_hash_argon2(const char* pass, const size_t pass_len, const char* salt, const size_t salt_len);
+bool          XORenc_key_is_byte_sequence(const char* key);
+size_t        XORenc_hex_decode(uint8_t* data, const size_t data_len);
+size_t        XORenc_base64_decode(uint8_t* data, const size_t data_len);
+TXORencKey    XORenc_key_load(const char* str, const size_t block);
+void          XORenc_encrypt_xor(uint8_t* data, const size_t data_len, const uint8_t* key, const size_t key_len);
+void          XORenc_encrypt_xor_multi(uint8_t* data, const size_t data_len, const uint8_t* const* keys, const size_t key_count);
+void          XORenc_chacha20(const uint8_t* key, const uint64_t nonce, uint64_t counter, uint8_t* out, const size_t out_len);
+uint32_t      XORenc_crc32c(uint32_t crc, const uint8_t* data, const size_t data_len);
+int           XORenc_compress_load(const TXORencCompression algo);
+size_t        XORenc_compress_bound(const TXORencCompression algo, const size_t src_len);
+size_t        XORenc_compress(const TXORencCompression algo, const uint8_t* src, const size_t src_len, uint8_t* dst, const size_t dst_cap);
+size_t        XORenc_decompress(const TXORencCompression algo, const uint8_t* src, const size_t src_len, uint8_t* dst, const size_t dst_cap);
+TXORencHash   XORenc_derive_block(const char* key, const size_t key_len, char* last_md5[], char* md5sum[], const TXORencParams* params);
+int           XORenc_encrypt_derived_next(char* last_md5[], uint8_t* data, const size_t data_len, const char* key, const size_t key_len, char* md5sum[]);
+int           XORenc_encrypt_derived_first(uint8_t* data, const size_t data_len, const char* key, const size_t key_len, char* md5sum[]);
+
+/* ******* --- xorenc_implementation.c --- ******* */
+
+const char*   XORenc_error_message(const int error);
+int           XORenc_init(TXORencContext** ctx, const char* key, const TXORencParams params);
+int           XORenc_update(TXORencContext* ctx, uint8_t* data, const size_t data_len);
+int           XORenc_update_iov(TXORencContext* ctx, const struct iovec* iov, const int iovcnt);
+int           XORenc_seek(TXORencContext* ctx, const uint64_t position);
+int           XORenc_final(TXORencContext* ctx);
+int           XORenc_write_to_file(const char* filename, const char* extension, const uint8_t* buf, const size_t buf_len, const bool overwrite, const bool std_out);
+int           XORenc_encrypt(const char* filename, const char* key_filename, const char* key_str, const TXORencParams params, const bool std_out);
+int           XORenc_encrypt_fd(const int in_fd, const int out_fd, const char* key, const TXORencParams params);
+int           XORenc_encrypt_range(const int in_fd, const int out_fd, const char* key, const uint64_t offset, const uint64_t length, const TXORencParams params);
+int           XORenc_encrypt_part(const int in_fd, const int out_fd, const char* key, const uint64_t position, const TXORencParams params);
+int           XORenc_pad_allocate(const char* pad, const uint64_t length, uint64_t* offset);
+int           XORenc_encrypt_pad(const int in_fd, const int out_fd, const char* pad, const TXORencParams params);
+int           XORenc_generate_key(const char* filename, const uint64_t size, unsigned int threads, const TXORencParams params);
+bool          XORenc_is_checked(const int in_fd);
+int           XORenc_encrypt_checked(const int in_fd, const int out_fd, const char* key, const bool seal, const TXORencParams params);
+int           XORenc_encrypt_compressed(const int in_fd, const int out_fd, const char* key, const TXORencCompression algo, const TXORencParams params);
+int           XORenc_encrypt_follow(const char* filename, const int out_fd, const char* key, const uint64_t latency_ms, const int stop_fd, const TXORencParams params);
+int           XORenc_encrypt_in_place(const char* filename, const char* key, const TXORencParams params);
+int           XORenc_process_file(const char* filename, const char* key, const bool std_out, const TXORencParams params);
+
+#endif
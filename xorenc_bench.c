@@ -0,0 +1,1418 @@
+// Warning: Best read if using a monospaced/fixed-width font and tab width of 4.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <inttypes.h>
+//---
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+//---
+#include "xorenc.h" // libxorenc
+
+/** ================================================================================
+
+	This file is part of 'XORenc'.
+
+	'XORenc' is a "XOR-based" data encryption tool.
+
+
+	License:
+
+	The MIT License (MIT)
+
+	Copyright (c) 2019 Renan Souza da Motta <renansouzadamotta@yahoo.com>
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy of
+	this software and associated documentation files (the "Software"), to deal in
+	the Software without restriction, including without limitation the rights to
+	use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+	the Software, and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+	FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+	COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+	IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+	CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	================================================================================ */
+
+/** ----------------------------------------------------------------
+
+	'libxorenc' benchmark (make bench) and known-answer check
+	(make check).
+
+	Every benchmark is run 'samples' times, each sample timing
+	'iterations' calls; results are the time of a single call (in
+	nanoseconds) summarized over all samples, written as JSON:
+
+		xorenc_bench [options] [output.json]
+
+	Options:
+
+		--vectors <file>         Check every engine against known-answer vectors first.
+		--record-vectors <file>  Rewrite answers of vectors with this build (trusted builds only!).
+		--baseline <file>        Compare results with stored results (a previous output).
+		--threshold <percent>    Slowdown allowed against baseline (default: 10).
+		--no-bench               Only check vectors.
+
+	Exits with 1 if any vector does not match or any benchmark is
+	slower than baseline past threshold.
+
+	---------------------------------------------------------------- */
+#define BENCH_SAMPLES       15        // samples of micro benchmarks
+#define BENCH_SAMPLE_NS     20000000  // minimum time of a sample of micro benchmarks (in nanoseconds)
+#define BENCH_KDF_SAMPLES   3         // samples of Argon2/Scrypt and derived runs (each one takes seconds)
+#define BENCH_DIRECT_SIZE   (64 * 1024 * 1024)
+#define BENCH_DERIVED_SIZE  (2 * 1024 * 1024)
+#define BENCH_MAX_RESULTS   64
+#define BENCH_KEY_SIZE      256       // maximum size of benchmark/vector description
+#define BENCH_MAX_KEYS      4         // maximum number of direct keys of a vector
+
+typedef void (*TBenchFunction)(void* arg);
+
+FILE*       m_output;              // where results are written to
+bool        m_first_result = true;
+char        m_result_keys[BENCH_MAX_RESULTS][BENCH_KEY_SIZE]; // name and arguments of every result
+double      m_result_best[BENCH_MAX_RESULTS];       // fastest sample of every result (least affected by noise)
+size_t      m_result_count = 0;
+char        m_temp_dir[]   = "/tmp/xorenc_bench.XXXXXX";
+const char* m_password     = "d2YqJUiaCawZzkq";
+
+/** ----------------------------------------------------------------------------------------
+
+	m_CompareSamples:
+
+		Compare samples (for 'qsort').
+
+	---------------------------------------------------------------------------------------- */
+int m_CompareSamples(const void* a, const void* b) {
+
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+
+	return (x > y) - (x < y);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_WriteResult:
+
+		Write statistical summary of samples as JSON object.
+
+	Parameters:
+
+		name       -> Name of benchmark.
+
+		args       -> Extra JSON members describing benchmark (e.g. "\"size\": 1024"), or "".
+
+		samples    -> Time of a single call in each sample (in nanoseconds), it gets sorted.
+
+		count      -> Number of samples.
+
+		iterations -> Calls timed by each sample.
+
+		bytes      -> Bytes processed by a single call (0 if it does not apply).
+
+	---------------------------------------------------------------------------------------- */
+void m_WriteResult(const char* name, const char* args, double samples[], const size_t count, const uint64_t iterations, const size_t bytes) {
+
+	double       mean   = 0;
+	double       stddev = 0;
+	double       median;
+	unsigned int lpp0;
+
+	qsort(samples, count, sizeof(double), m_CompareSamples);
+
+	for (lpp0=0; lpp0 < count; lpp0++) {
+		mean += samples[lpp0] / count;
+	}
+
+	for (lpp0=0; lpp0 < count; lpp0++) {
+		stddev += (samples[lpp0] - mean) * (samples[lpp0] - mean) / ((count > 1) ? (count - 1) : 1);
+	}
+
+	stddev = sqrt(stddev);
+	median = (count % 2) ? samples[count / 2] : ((samples[count / 2 - 1] + samples[count / 2]) / 2);
+
+	// results are kept to be compared with baseline (see 'm_CompareBaseline')
+	if (m_result_count < BENCH_MAX_RESULTS) {
+		snprintf(m_result_keys[m_result_count], BENCH_KEY_SIZE, "{\"name\": \"%s\", %s%s", name, args, (args[0] != '\0') ? ", " : "");
+
+		m_result_best[m_result_count] = samples[0];
+		m_result_count               += 1;
+	}
+
+	fprintf(m_output, "%s\n\t\t{\"name\": \"%s\", %s%s\"samples\": %zu, \"iterations\": %" PRIu64 ", ",
+			m_first_result ? "" : ",", name, args, (args[0] != '\0') ? ", " : "", count, iterations);
+	fprintf(m_output, "\"ns\": {\"min\": %.1f, \"median\": %.1f, \"mean\": %.1f, \"stddev\": %.1f, \"p90\": %.1f, \"max\": %.1f}",
+			samples[0], median, mean, stddev, samples[(count * 9) / 10 - ((count * 9) % 10 == 0)], samples[count - 1]);
+
+	if (bytes > 0) {
+		fprintf(m_output, ", \"bytes\": %zu, \"bytes_per_second\": %.0f", bytes, bytes * 1e9 / median);
+	}
+
+	fprintf(m_output, "}");
+
+	m_first_result = false;
+
+	fprintf(stderr, "%-16s %-36s median %14.1f ns\n", name, args, median);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_Bench:
+
+		Time function, calling it enough times for every sample to last at least
+		'BENCH_SAMPLE_NS' (at least once if 'min_ns' is 0), and write result.
+
+	---------------------------------------------------------------------------------------- */
+void m_Bench(const char* name, const char* args, TBenchFunction function, void* arg, const size_t samples, const uint64_t min_ns, const size_t bytes) {
+
+	double*      times      = calloc(samples, sizeof(double));
+	uint64_t     iterations = 1;
+	uint64_t     t0, lpp1;
+	unsigned int lpp0;
+
+	if (times == NULL) {
+		return;
+	}
+
+	// find number of iterations for one sample (also warms up caches)
+	while (min_ns > 0) {
+		t0 = XORenc_clock();
+
+		for (lpp1=0; lpp1 < iterations; lpp1++) {
+			function(arg);
+		}
+
+		if ((XORenc_clock() - t0) >= min_ns) {
+			break;
+		}
+
+		iterations *= 2;
+	}
+
+	for (lpp0=0; lpp0 < samples; lpp0++) {
+		t0 = XORenc_clock();
+
+		for (lpp1=0; lpp1 < iterations; lpp1++) {
+			function(arg);
+		}
+
+		times[lpp0] = (double)(XORenc_clock() - t0) / iterations;
+	}
+
+	m_WriteResult(name, args, times, samples, iterations, bytes);
+
+	free(times);
+}
+
+/* ******* --- benchmarked functions --- ******* */
+
+typedef struct {
+	uint8_t*    data;
+	size_t      length;
+	uint8_t*    key;
+	const char* path;
+	const char* key_str;
+	size_t      block;
+} TBenchArg;
+
+void m_BenchXOR(void* arg) {
+
+	TBenchArg* a = arg;
+
+	XORenc_encrypt_xor(a->data, a->length, a->key, a->length);
+}
+
+void m_BenchKeyLoad(void* arg) {
+
+	TBenchArg* a   = arg;
+	TXORencKey key = XORenc_key_load(a->key_str, a->block);
+
+	free(key.data);
+}
+
+void m_BenchWrite(void* arg) {
+
+	TBenchArg* a = arg;
+
+	// file is truncated first, so it never grows beyond a single block
+	truncate(a->path, 0);
+
+	XORenc_write_to_file(a->path, NULL, a->data, a->length, true, false);
+}
+
+void m_BenchArgon2(void* arg) {
+
+	TBenchArg*  a    = arg;
+	TXORencHash hash = XORenc_hash_argon2(m_password, strlen(m_password), a->key_str, strlen(a->key_str));
+
+	free(hash.data);
+}
+
+void m_BenchScrypt(void* arg) {
+
+	TBenchArg*  a    = arg;
+	TXORencHash hash = XORenc_hash_scrypt(m_password, strlen(m_password), a->key_str, strlen(a->key_str));
+
+	free(hash.data);
+}
+
+void m_BenchProcessFile(void* arg) {
+
+	TBenchArg*    a      = arg;
+	char          output[4096];
+	TXORencParams params = { (a->key_str == m_password) ? Derived : Direct, NULL, NULL, NULL };
+
+	snprintf(output, sizeof(output), "%s.xen", a->path);
+	unlink(output);
+
+	if (XORenc_process_file(a->path, a->key_str, false, params) < 0) {
+		fprintf(stderr, "Error: Could not process \"%s\".\n", a->path);
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_CreateFile:
+
+		Create file of pseudo-random data in temporary folder.
+
+	---------------------------------------------------------------------------------------- */
+char* m_CreateFile(const char* name, const size_t length, const uint64_t seed) {
+
+	char*    RESULT = calloc(1, 4096);
+	uint8_t* buf    = malloc(XORENC_FILE_BLOCK_SIZE);
+	uint64_t state  = 0x9e3779b97f4a7c15 ^ seed;
+	size_t   done, lpp0;
+	FILE*    fd0;
+
+	snprintf(RESULT, 4096, "%s/%s", m_temp_dir, name);
+
+	fd0 = fopen(RESULT, "wb");
+
+	for (done=0; (fd0 != NULL) && (buf != NULL) && (done < length); done += XORENC_FILE_BLOCK_SIZE) {
+		for (lpp0=0; lpp0 < XORENC_FILE_BLOCK_SIZE; lpp0++) {
+			// xorshift64
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+
+			buf[lpp0] = state;
+		}
+
+		fwrite(buf, 1, (length - done < XORENC_FILE_BLOCK_SIZE) ? (length - done) : XORENC_FILE_BLOCK_SIZE, fd0);
+	}
+
+	if (fd0 != NULL) {
+		fclose(fd0);
+	}
+
+	free(buf);
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------
+
+	Known-answer vectors, one per line of vectors file:
+
+		<name> <direct|cyclic|derived> <length> <seed> <key> <md5>
+
+	Input is 'length' bytes generated from 'seed' (see 'm_CreateFile'),
+	'key' is either '@<seed>[:<length>]' (key file generated from seed,
+	as long as input unless its length is given), 'hex:<bytes>' (byte
+	sequence, e.g. 'hex:A1B2C3' means 'A1 B2 C3') or a password; 'md5'
+	is md5sum of the output. Mode 'cyclic' is a direct key repeated
+	when shorter than the data ('TXORencParams.cyclic_key'). Several
+	direct keys are joined with '+' (e.g. '@1+@2'), the first one is
+	the key and the others 'TXORencParams.extra_keys'.
+
+	Key files may also be given as 'hex@<seed>[:<length>]' and
+	'b64@<seed>[:<length>]' (the same key file, hex or base64 encoded
+	and read with 'TXORencParams.key_format'), 'pipe@<seed>[:<length>]'
+	(read from a pipe as '/dev/fd/N', like '--key-fd') or as text
+	holding an encoded key ('hexfile:<text>' or 'b64file:<text>'). An
+	'md5' of 'error' means the key must be rejected ('XORENC_ERROR_KEY').
+
+	Every engine (way of en/de-crypting data) must give the same
+	output, so optimizations can not change it unnoticed.
+
+	---------------------------------------------------------------- */
+typedef struct {
+	char             name[64];
+	char             key_spec[256];
+	char             md5[33];
+	size_t           length;
+	uint64_t         seed;
+	TXORencKeyType   key_type;
+	bool             cyclic_key;      // direct key repeated when shorter than the data (mode 'cyclic')
+	TXORencKeyFormat key_format;      // encoding of key files ('hex@', 'b64@', 'hexfile:' and 'b64file:')
+	bool             key_pipe;        // key is read from a pipe ('pipe@'), see 'm_PipeKey'
+	char             key_file[512];   // path of key file sent through pipe
+	char*            input;           // path of generated input
+	char             key[512];        // key as given to 'libxorenc' (path, byte sequence or password)
+	char             extra[BENCH_MAX_KEYS - 1][512]; // extra direct keys, as 'key'
+	const char*      extra_keys[BENCH_MAX_KEYS - 1]; // pointers to 'extra', see 'TXORencParams.extra_keys'
+	size_t           extra_key_count;
+} TVector;
+
+typedef int (*TEngine)(const TVector* vector, uint8_t* data);
+
+/** ----------------------------------------------------------------------------------------
+
+	m_VectorParams:
+
+		Parameters of 'libxorenc' for vector.
+
+	---------------------------------------------------------------------------------------- */
+TXORencParams m_VectorParams(const TVector* vector) {
+
+	TXORencParams RESULT = { vector->key_type, NULL, NULL, NULL };
+
+	RESULT.cyclic_key      = vector->cyclic_key;
+	RESULT.key_format      = vector->key_format;
+	RESULT.extra_keys      = (vector->extra_key_count > 0) ? (const char**)vector->extra_keys : NULL;
+	RESULT.extra_key_count = vector->extra_key_count;
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ReadFile:
+
+		Read whole file into 'data' (at most 'length' bytes).
+
+	Return value:
+
+		Returns number of bytes read, or -1 if it fails.
+
+	---------------------------------------------------------------------------------------- */
+ssize_t m_ReadFile(const char* path, uint8_t* data, const size_t length) {
+
+	FILE*  fd0 = fopen(path, "rb");
+	size_t RESULT;
+
+	if (fd0 == NULL) {
+		return -1;
+	}
+
+	RESULT = fread(data, 1, length, fd0);
+
+	// output must not be longer than input
+	if (fgetc(fd0) != EOF) {
+		RESULT = -1;
+	}
+
+	fclose(fd0);
+
+	return RESULT;
+}
+
+/* ******* --- engines --- ******* */
+
+// whole file, as the command line does
+int m_EngineEncrypt(const TVector* vector, uint8_t* data) {
+
+	char          output[4096];
+	TXORencParams params = m_VectorParams(vector);
+
+	int           r;
+
+	snprintf(output, sizeof(output), "%s.xen", vector->input);
+	unlink(output);
+
+	r = XORenc_process_file(vector->input, vector->key, false, params);
+
+	if (r < 0) {
+		return r;
+	}
+
+	return (m_ReadFile(output, data, vector->length) == (ssize_t)vector->length) ? 0 : -1;
+}
+
+// descriptors, as the daemon does
+int m_EngineEncryptFD(const TVector* vector, uint8_t* data) {
+
+	char          output[4096];
+	TXORencParams params = m_VectorParams(vector);
+	int           in_fd, out_fd, r;
+
+	snprintf(output, sizeof(output), "%s.fd", vector->input);
+
+	in_fd  = open(vector->input, O_RDONLY);
+	out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+	r = ((in_fd < 0) || (out_fd < 0)) ? -1 : XORenc_encrypt_fd(in_fd, out_fd, vector->key, params);
+
+	close(in_fd);
+	close(out_fd);
+
+	if (r < 0) {
+		return r;
+	}
+
+	return (m_ReadFile(output, data, vector->length) == (ssize_t)vector->length) ? 0 : -1;
+}
+
+// streaming, in chunks that never match block boundaries
+int m_EngineUpdate(const TVector* vector, uint8_t* data) {
+
+	TXORencParams   params = m_VectorParams(vector);
+	TXORencContext* ctx;
+	size_t          done;
+	int             r;
+
+	if (m_ReadFile(vector->input, data, vector->length) != (ssize_t)vector->length) {
+		return -1;
+	}
+
+	r = XORenc_init(&ctx, vector->key, params);
+
+	if (r < 0) {
+		return r;
+	}
+
+	for (done=0, r=0; (r >= 0) && (done < vector->length); done += 4093) {
+		r = XORenc_update(ctx, &data[done], (vector->length - done < 4093) ? (vector->length - done) : 4093);
+	}
+
+	XORenc_final(ctx);
+
+	return r;
+}
+
+// streaming, scatter-gather
+int m_EngineUpdateIOV(const TVector* vector, uint8_t* data) {
+
+	const size_t    SIZES[3] = { 7, 65536, 1048576 };
+	TXORencParams   params   = m_VectorParams(vector);
+	TXORencContext* ctx;
+	struct iovec    iov[3];
+	size_t          done = 0;
+	int             r    = 0;
+	int             lpp0;
+
+	if (m_ReadFile(vector->input, data, vector->length) != (ssize_t)vector->length) {
+		return -1;
+	}
+
+	r = XORenc_init(&ctx, vector->key, params);
+
+	if (r < 0) {
+		return r;
+	}
+
+	while ((r >= 0) && (done < vector->length)) {
+		for (lpp0=0; (lpp0 < 3) && (done < vector->length); lpp0++) {
+			iov[lpp0].iov_base = &data[done];
+			iov[lpp0].iov_len  = (vector->length - done < SIZES[lpp0]) ? (vector->length - done) : SIZES[lpp0];
+
+			done += iov[lpp0].iov_len;
+		}
+
+		r = XORenc_update_iov(ctx, iov, lpp0);
+	}
+
+	XORenc_final(ctx);
+
+	return r;
+}
+
+// random access, second half first and then back to the start
+int m_EngineSeek(const TVector* vector, uint8_t* data) {
+
+	TXORencParams   params = m_VectorParams(vector);
+	TXORencContext* ctx;
+	size_t          half   = vector->length / 2;
+	int             r;
+
+	if (m_ReadFile(vector->input, data, vector->length) != (ssize_t)vector->length) {
+		return -1;
+	}
+
+	r = XORenc_init(&ctx, vector->key, params);
+
+	if (r < 0) {
+		return r;
+	}
+
+	r = XORenc_seek(ctx, half);
+
+	if (r >= 0) {
+		r = XORenc_update(ctx, &data[half], vector->length - half);
+	}
+
+	if (r >= 0) {
+		r = XORenc_seek(ctx, 0);
+	}
+
+	if (r >= 0) {
+		r = XORenc_update(ctx, data, half);
+	}
+
+	XORenc_final(ctx);
+
+	return r;
+}
+
+// block by block, with 'XORenc_encrypt_derived_first' and 'XORenc_encrypt_derived_next'
+int m_EngineDerivedBlocks(const TVector* vector, uint8_t* data) {
+
+	char   md5sum_1[2][(16*2)+1];
+	char   md5sum_2[2][(16*2)+1];
+	char*  md5sum[2][2] = { { md5sum_1[0], md5sum_2[0] }, { md5sum_1[1], md5sum_2[1] } };
+	size_t done, block_len;
+	int    block, r = 0;
+
+	if ((vector->key_type != Derived) || (m_ReadFile(vector->input, data, vector->length) != (ssize_t)vector->length)) {
+		return (vector->key_type != Derived) ? 1 : -1;
+	}
+
+	for (done=0, block=0; (r >= 0) && (done < vector->length); done += block_len, block++) {
+		block_len = (vector->length - done < XORENC_FILE_BLOCK_SIZE) ? (vector->length - done) : XORENC_FILE_BLOCK_SIZE;
+
+		// md5sum of previous block is the salt of the next one
+		if (block == 0) {
+			r = XORenc_encrypt_derived_first(&data[done], block_len, vector->key, strlen(vector->key), md5sum[0]);
+		}
+		else {
+			r = XORenc_encrypt_derived_next(md5sum[(block - 1) % 2], &data[done], block_len, vector->key, strlen(vector->key), md5sum[block % 2]);
+		}
+	}
+
+	return r;
+}
+
+// several direct keys, one pass per key instead of all of them XOR'ed in the same pass
+int m_EngineSequential(const TVector* vector, uint8_t* data) {
+
+	TXORencParams   params = m_VectorParams(vector);
+	TXORencContext* ctx;
+	size_t          lpp0;
+	int             r      = 0;
+
+	if ((vector->extra_key_count == 0) || (m_ReadFile(vector->input, data, vector->length) != (ssize_t)vector->length)) {
+		return (vector->extra_key_count == 0) ? 1 : -1;
+	}
+
+	params.extra_keys      = NULL;
+	params.extra_key_count = 0;
+
+	for (lpp0=0; (r >= 0) && (lpp0 < 1 + vector->extra_key_count); lpp0++) {
+		r = XORenc_init(&ctx, (lpp0 == 0) ? vector->key : vector->extra_keys[lpp0 - 1], params);
+
+		if (r >= 0) {
+			r = XORenc_update(ctx, data, vector->length);
+
+			XORenc_final(ctx);
+		}
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_EngineChecked:
+
+		Checksum trailer ('--checksum' and '--verify'), see 'XORenc_encrypt_checked'. Output
+		is the data of sealed file, which must be followed by a trailer; sealed file must also
+		decrypt back to input, be verified without writing any output, and be rejected when
+		a byte of it is flipped or it is decrypted with a wrong key.
+
+	---------------------------------------------------------------------------------------- */
+int m_EngineChecked(const TVector* vector, uint8_t* data) {
+
+	TXORencParams params = m_VectorParams(vector);
+	TXORencStats  stats;
+	char          sealed[4096];
+	char          opened[4096];
+	char          wrong[512];
+	const char*   failure = NULL;
+	uint8_t*      input   = malloc(vector->length);
+	uint64_t      blocks  = (vector->length + XORENC_FILE_BLOCK_SIZE - 1) / XORENC_FILE_BLOCK_SIZE;
+	struct stat   sealed_stat;
+	uint8_t       byte;
+	int           in_fd, out_fd, r;
+
+	if (vector->key_pipe) {
+		// key is read several times, a pipe only once
+		free(input);
+
+		return 1;
+	}
+
+	if ((input == NULL) || (m_ReadFile(vector->input, input, vector->length) != (ssize_t)vector->length)) {
+		free(input);
+
+		return -1;
+	}
+
+	snprintf(sealed, sizeof(sealed), "%s.crc", vector->input);
+	snprintf(opened, sizeof(opened), "%s.crc.out", vector->input);
+
+
+	// seal, its data is the output of vector
+	in_fd  = open(vector->input, O_RDONLY);
+	out_fd = open(sealed, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+	r = ((in_fd < 0) || (out_fd < 0)) ? -1 : XORenc_encrypt_checked(in_fd, out_fd, vector->key, true, params);
+
+	close(in_fd);
+	close(out_fd);
+
+	in_fd = open(sealed, O_RDWR);
+
+	if ((r >= 0) && ((in_fd < 0) || (fstat(in_fd, &sealed_stat) != 0) || ((uint64_t)sealed_stat.st_size != vector->length + (blocks * 4) + 24) ||
+	                 (! XORenc_is_checked(in_fd)) || (pread(in_fd, data, vector->length, 0) != (ssize_t)vector->length))) {
+		failure = "no trailer after data";
+	}
+
+
+	// decrypt back to input
+	if ((r >= 0) && (failure == NULL)) {
+		out_fd = open(opened, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+		r = (out_fd < 0) ? -1 : XORenc_encrypt_checked(in_fd, out_fd, vector->key, false, params);
+
+		close(out_fd);
+
+		if (r >= 0) {
+			uint8_t* decrypted = malloc(vector->length);
+
+			if ((decrypted == NULL) || (m_ReadFile(opened, decrypted, vector->length) != (ssize_t)vector->length) || (memcmp(decrypted, input, vector->length) != 0)) {
+				failure = "decrypted data differs from input";
+			}
+
+			free(decrypted);
+		}
+	}
+
+	// verify only ('--verify'), nothing is written
+	if ((r >= 0) && (failure == NULL)) {
+		memset(&stats, 0, sizeof(stats));
+
+		params.stats = &stats;
+
+		r = XORenc_encrypt_checked(in_fd, -1, vector->key, false, params);
+
+		if ((r >= 0) && (stats.bytes_out != 0)) {
+			failure = "verifying wrote output";
+		}
+
+		params.stats = NULL;
+	}
+
+	// flipped byte of data
+	if ((r >= 0) && (failure == NULL) && (pread(in_fd, &byte, 1, vector->length / 2) == 1)) {
+		byte ^= 0x01;
+
+		if ((pwrite(in_fd, &byte, 1, vector->length / 2) != 1) || (XORenc_encrypt_checked(in_fd, -1, vector->key, false, params) != XORENC_ERROR_CHECKSUM)) {
+			failure = "flipped byte was not rejected";
+		}
+
+		byte ^= 0x01;
+
+		if (pwrite(in_fd, &byte, 1, vector->length / 2) != 1) {
+			failure = "could not restore flipped byte";
+		}
+	}
+
+	// wrong key (another key file of the same length, or another password)
+	if ((r >= 0) && (failure == NULL)) {
+		char* wrong_file = NULL;
+
+		if (vector->key_type == Direct) {
+			snprintf(wrong, sizeof(wrong), "%s.wrong.key", vector->name);
+
+			wrong_file        = m_CreateFile(wrong, vector->length, ~vector->seed);
+			params.key_format = XORENC_KEY_RAW;
+		}
+
+		if (XORenc_encrypt_checked(in_fd, -1, (wrong_file != NULL) ? wrong_file : m_password, false, params) != XORENC_ERROR_CHECKSUM) {
+			failure = "wrong key was not rejected";
+		}
+
+		free(wrong_file);
+	}
+
+	if (in_fd >= 0) {
+		close(in_fd);
+	}
+
+	free(input);
+
+	if (failure != NULL) {
+		fprintf(stderr, "        vector \"%s\", engine \"checked\": %s\n", vector->name, failure);
+
+		return XORENC_ERROR_CHECKSUM;
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_EncodeFile:
+
+		Rewrite file as hex or base64 text, in lines (whitespace is ignored when decoded).
+
+	Return value:
+
+		Returns 0 if successful, -1 if it fails.
+
+	---------------------------------------------------------------------------------------- */
+int m_EncodeFile(const char* path, const TXORencKeyFormat format) {
+
+	const char*  BASE64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	struct stat  file_stat;
+	uint8_t*     raw;
+	FILE*        fd0;
+	size_t       lpp0;
+	int          RESULT = 0;
+
+	if ((stat(path, &file_stat) != 0) || ((raw = malloc(file_stat.st_size + 1)) == NULL)) {
+		return -1;
+	}
+
+	if (m_ReadFile(path, raw, file_stat.st_size) != file_stat.st_size) {
+		free(raw);
+
+		return -1;
+	}
+
+	fd0 = fopen(path, "wb");
+
+	if (fd0 == NULL) {
+		free(raw);
+
+		return -1;
+	}
+
+	if (format == XORENC_KEY_HEX) {
+		for (lpp0=0; lpp0 < (size_t)file_stat.st_size; lpp0++) {
+			fprintf(fd0, "%02x%s", raw[lpp0], ((lpp0 % 32) == 31) ? "\n" : "");
+		}
+	}
+	else {
+		// every 3 bytes are 4 symbols, last group padded with '='
+		for (lpp0=0; lpp0 < (size_t)file_stat.st_size; lpp0 += 3) {
+			size_t   left  = file_stat.st_size - lpp0;
+			uint32_t value = (raw[lpp0] << 16) | ((left > 1) ? (raw[lpp0 + 1] << 8) : 0) | ((left > 2) ? raw[lpp0 + 2] : 0);
+
+			fprintf(fd0, "%c%c%c%c%s", BASE64[(value >> 18) & 63], BASE64[(value >> 12) & 63],
+					(left > 1) ? BASE64[(value >> 6) & 63] : '=', (left > 2) ? BASE64[value & 63] : '=', ((lpp0 % 57) == 54) ? "\n" : "");
+		}
+	}
+
+	if (fclose(fd0) != 0) {
+		RESULT = -1;
+	}
+
+	free(raw);
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_PipeKey:
+
+		Send key file of vector through a pipe, written by a child process, and give the
+		read end to 'libxorenc' as '/dev/fd/N' (like '--key-fd'). A pipe can be read once,
+		so a new one is made for every engine.
+
+	Parameters:
+
+		vector -> The vector, its 'key' is set to the read end of pipe.
+
+		fd     -> Where to store read end of pipe (closed by caller).
+
+	Return value:
+
+		Returns process id of writer, or -1 if it fails.
+
+	---------------------------------------------------------------------------------------- */
+pid_t m_PipeKey(TVector* vector, int* fd) {
+
+	int   fds[2];
+	pid_t RESULT;
+
+	if (pipe(fds) != 0) {
+		return -1;
+	}
+
+	RESULT = fork();
+
+	if (RESULT == 0) {
+		uint8_t buf[65536];
+		ssize_t got;
+		int     fd0 = open(vector->key_file, O_RDONLY);
+
+		close(fds[0]);
+
+		while ((fd0 >= 0) && ((got = read(fd0, buf, sizeof(buf))) > 0) && (write(fds[1], buf, got) == got));
+
+		_exit(0);
+	}
+
+	close(fds[1]);
+
+	if (RESULT < 0) {
+		close(fds[0]);
+
+		return -1;
+	}
+
+	*fd = fds[0];
+
+	snprintf(vector->key, sizeof(vector->key), "/dev/fd/%d", fds[0]);
+
+	return RESULT;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ParseKey:
+
+		Parse a single key of vector (see its formats above), generating its key file if it
+		is one.
+
+	Parameters:
+
+		vector -> The vector.
+
+		spec   -> Key as given in vectors file.
+
+		index  -> Number of key in vector (names its key file).
+
+		key    -> Where to store key as given to 'libxorenc' ('size' bytes).
+
+	---------------------------------------------------------------------------------------- */
+void m_ParseKey(TVector* vector, const char* spec, const unsigned int index, char* key, const size_t size) {
+
+	char         name[4096];
+	unsigned int lpp0;
+
+	if ((strncmp(spec, "@", 1) == 0) || (strncmp(spec, "hex@", 4) == 0) || (strncmp(spec, "b64@", 4) == 0) || (strncmp(spec, "pipe@", 5) == 0)) {
+		char*    key_file;
+		char*    end;
+		uint64_t key_seed   = strtoull(&strchr(spec, '@')[1], &end, 10);
+		size_t   key_length = (*end == ':') ? strtoull(&end[1], NULL, 10) : vector->length;
+
+		snprintf(name, sizeof(name), "%s.%u.key", vector->name, index);
+
+		key_file = m_CreateFile(name, key_length, key_seed);
+
+		if (spec[0] == 'h') {
+			vector->key_format = XORENC_KEY_HEX;
+
+			m_EncodeFile(key_file, XORENC_KEY_HEX);
+		}
+		else if (spec[0] == 'b') {
+			vector->key_format = XORENC_KEY_BASE64;
+
+			m_EncodeFile(key_file, XORENC_KEY_BASE64);
+		}
+		else if (spec[0] == 'p') {
+			vector->key_pipe = true;
+
+			snprintf(vector->key_file, sizeof(vector->key_file), "%s", key_file);
+		}
+
+		snprintf(key, size, "%s", key_file);
+
+		free(key_file);
+	}
+	else if ((strncmp(spec, "hexfile:", 8) == 0) || (strncmp(spec, "b64file:", 8) == 0)) {
+		// key file holding the text as it is (e.g. invalid encoding)
+		FILE* fd0;
+
+		snprintf(key, size, "%s/%s.%u.key", m_temp_dir, vector->name, index);
+
+		fd0 = fopen(key, "wb");
+
+		if (fd0 != NULL) {
+			fputs(&spec[8], fd0);
+			fclose(fd0);
+		}
+
+		vector->key_format = (spec[0] == 'h') ? XORENC_KEY_HEX : XORENC_KEY_BASE64;
+	}
+	else if (strncmp(spec, "hex:", 4) == 0) {
+		// 'A1B2C3' -> 'A1 B2 C3'
+		for (lpp0=0; (spec[4 + lpp0*2] != '\0') && (lpp0*3 + 3 < size); lpp0++) {
+			sprintf(&key[lpp0*3], "%.2s ", &spec[4 + lpp0*2]);
+		}
+
+		if (lpp0 > 0) {
+			key[lpp0*3 - 1] = '\0';
+		}
+	}
+	else {
+		snprintf(key, size, "%s", spec);
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_ParseVector:
+
+		Parse line of vectors file and generate its input (and key files).
+
+	Return value:
+
+		Returns 0 if successful, 1 if line is empty or a comment.
+
+	---------------------------------------------------------------------------------------- */
+int m_ParseVector(const char* line, TVector* vector) {
+
+	char         mode[16];
+	char         name[4096];
+	char         spec[256];
+	char*        next;
+	char*        saveptr;
+	unsigned int lpp0;
+
+	memset(vector, 0, sizeof(*vector));
+
+	if ((line[0] == '#') || (line[0] == '\n')) {
+		return 1;
+	}
+
+	if ((sscanf(line, "%63s %15s %zu %" SCNu64 " %255s %32s", vector->name, mode, &vector->length, &vector->seed, vector->key_spec, vector->md5) < 5) ||
+	    (vector->length == 0)) {
+		return -1;
+	}
+
+	vector->key_type   = (strcmp(mode, "derived") == 0) ? Derived : Direct;
+	vector->cyclic_key = (strcmp(mode, "cyclic") == 0);
+
+	snprintf(name, sizeof(name), "%s.bin", vector->name);
+
+	vector->input = m_CreateFile(name, vector->length, vector->seed);
+
+	if (vector->key_type == Derived) {
+		// password, may contain '+'
+		m_ParseKey(vector, vector->key_spec, 0, vector->key, sizeof(vector->key));
+
+		return 0;
+	}
+
+	snprintf(spec, sizeof(spec), "%s", vector->key_spec);
+
+	for (lpp0=0, next=strtok_r(spec, "+", &saveptr); next != NULL; lpp0++, next=strtok_r(NULL, "+", &saveptr)) {
+		if (lpp0 >= BENCH_MAX_KEYS) {
+			return -1;
+		}
+
+		if (lpp0 == 0) {
+			m_ParseKey(vector, next, lpp0, vector->key, sizeof(vector->key));
+		}
+		else {
+			m_ParseKey(vector, next, lpp0, vector->extra[lpp0 - 1], sizeof(vector->extra[0]));
+
+			vector->extra_keys[lpp0 - 1] = vector->extra[lpp0 - 1];
+			vector->extra_key_count      = lpp0;
+		}
+	}
+
+	return 0;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_CheckVectors:
+
+		Check every engine against known-answer vectors in file (or record answers).
+
+	Parameters:
+
+		filename -> Path to vectors file.
+
+		record   -> Rewrite answers with output of this build instead of checking them.
+
+	Return value:
+
+		Returns number of failures (0 if all outputs match), or -1 if file could not be read.
+
+	---------------------------------------------------------------------------------------- */
+int m_CheckVectors(const char* filename, const bool record) {
+
+	const char*  ENGINE_NAMES[] = { "encrypt", "encrypt_fd", "update", "update_iov", "seek", "derived_blocks", "sequential", "checked" };
+	TEngine      ENGINES[]      = { m_EngineEncrypt, m_EngineEncryptFD, m_EngineUpdate, m_EngineUpdateIOV, m_EngineSeek, m_EngineDerivedBlocks, m_EngineSequential, m_EngineChecked };
+	char         line[1024];
+	char*        recorded = calloc(1, 1024 * 64);
+	int          failures = 0;
+	unsigned int lpp0;
+	TVector      vector;
+	FILE*        fd0 = fopen(filename, "r");
+
+	if ((fd0 == NULL) || (recorded == NULL)) {
+		free(recorded);
+
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fd0) != NULL) {
+		int r = m_ParseVector(line, &vector);
+
+		if (r != 0) {
+			if ((r > 0) && (strlen(recorded) + strlen(line) < 1024 * 64)) {
+				strcat(recorded, line);
+			}
+
+			failures += (r < 0);
+
+			continue;
+		}
+
+		uint8_t* data = malloc(vector.length);
+
+		for (lpp0=0; (data != NULL) && (lpp0 < sizeof(ENGINES) / sizeof(ENGINES[0])); lpp0++) {
+			uint8_t digest_b[16];
+			char    digest_s[33] = { 0 };
+			bool    rejected     = (strcmp(vector.md5, "error") == 0);
+			pid_t   writer       = -1;
+			int     key_fd       = -1;
+
+			// first engine is the reference when recording
+			if (record && (lpp0 > 0)) {
+				break;
+			}
+
+			if (vector.key_pipe) {
+				writer = m_PipeKey(&vector, &key_fd);
+			}
+
+			r = ENGINES[lpp0](&vector, data);
+
+			if (writer > 0) {
+				close(key_fd);
+				waitpid(writer, NULL, 0);
+			}
+
+			if (r > 0) {
+				// engine does not apply to this vector
+				continue;
+			}
+
+			if (r >= 0) {
+				XORenc_md5(data, vector.length, digest_b, digest_s);
+			}
+
+			if ((record) && (r < 0)) {
+				snprintf(digest_s, sizeof(digest_s), "error");
+			}
+
+			if (record) {
+				snprintf(line, sizeof(line), "%-16s %-8s %-9zu %-3" PRIu64 " %-18s %s\n",
+						vector.name, (vector.key_type == Derived) ? "derived" : ((vector.cyclic_key) ? "cyclic" : "direct"), vector.length, vector.seed, vector.key_spec, digest_s);
+
+				if (strlen(recorded) + strlen(line) < 1024 * 64) {
+					strcat(recorded, line);
+				}
+			}
+			else if ((rejected) && (r != XORENC_ERROR_KEY)) {
+				fprintf(stderr, "FAILED: vector \"%s\", engine \"%s\" (%s)\n", vector.name, ENGINE_NAMES[lpp0], (r < 0) ? XORenc_error_message(r) : "key was not rejected");
+
+				failures += 1;
+			}
+			else if ((! rejected) && ((r < 0) || (strcmp(digest_s, vector.md5) != 0))) {
+				fprintf(stderr, "FAILED: vector \"%s\", engine \"%s\" (%s)\n", vector.name, ENGINE_NAMES[lpp0], (r < 0) ? XORenc_error_message(r) : "output differs");
+
+				failures += 1;
+			}
+			else {
+				fprintf(stderr, "ok:     vector \"%s\", engine \"%s\"\n", vector.name, ENGINE_NAMES[lpp0]);
+			}
+		}
+
+		failures += (data == NULL);
+
+		free(data);
+		free(vector.input);
+	}
+
+	fclose(fd0);
+
+	if (record) {
+		fd0 = fopen(filename, "w");
+
+		if ((fd0 == NULL) || (fputs(recorded, fd0) < 0)) {
+			failures += 1;
+		}
+
+		if (fd0 != NULL) {
+			fclose(fd0);
+		}
+	}
+
+	free(recorded);
+
+	return failures;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_CompareBaseline:
+
+		Compare fastest sample of every result with the same benchmark in baseline (an
+		output of a previous run); benchmarks missing from either one are skipped. The
+		fastest sample is used since it is the least affected by other load on the machine.
+
+	Parameters:
+
+		filename  -> Path to baseline.
+
+		threshold -> Slowdown allowed (in percent).
+
+	Return value:
+
+		Returns number of regressions (0 if none), or -1 if baseline could not be read.
+
+	---------------------------------------------------------------------------------------- */
+int m_CompareBaseline(const char* filename, const double threshold) {
+
+	char   line[1024];
+	int    regressions = 0;
+	size_t lpp0;
+	FILE*  fd0 = fopen(filename, "r");
+
+	if (fd0 == NULL) {
+		return -1;
+	}
+
+	// one result per line, beginning with its name and arguments (see 'm_WriteResult')
+	while (fgets(line, sizeof(line), fd0) != NULL) {
+		char*  best = strstr(line, "\"min\": ");
+		double baseline;
+
+		if ((best == NULL) || (sscanf(best, "\"min\": %lf", &baseline) != 1)) {
+			continue;
+		}
+
+		for (lpp0=0; lpp0 < m_result_count; lpp0++) {
+			char* key = strstr(line, m_result_keys[lpp0]);
+
+			// key must be followed by '"samples"', otherwise it is only the beginning of another key
+			if ((key == NULL) || (strncmp(&key[strlen(m_result_keys[lpp0])], "\"samples\"", 9) != 0)) {
+				continue;
+			}
+
+			double change = 100.0 * (m_result_best[lpp0] - baseline) / baseline;
+
+			if (change > threshold) {
+				fprintf(stderr, "REGRESSION: %s...}: %.1f ns -> %.1f ns (%+.1f%%)\n", m_result_keys[lpp0], baseline, m_result_best[lpp0], change);
+
+				regressions += 1;
+			}
+		}
+	}
+
+	fclose(fd0);
+
+	return regressions;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	m_RunBenchmarks:
+
+		Run all benchmarks, writing results to 'm_output'.
+
+	---------------------------------------------------------------------------------------- */
+int m_RunBenchmarks() {
+
+	const size_t SIZES[]      = { 16, 64, 256, 1024, 4096, 65536, 1048576, 16777216 };
+	const size_t ALIGNMENTS[] = { 0, 1, 3, 8 };
+	uint8_t*     data         = malloc(SIZES[7] + 64);
+	uint8_t*     key          = malloc(SIZES[7] + 64);
+	char         args[256];
+	char         key_bytes[3 * 1024];
+	TBenchArg    arg;
+	unsigned int lpp0, lpp1;
+
+	if ((data == NULL) || (key == NULL)) {
+		free(data);
+		free(key);
+
+		return -1;
+	}
+
+	memset(data, 0x5a, SIZES[7] + 64);
+	memset(key, 0xa5, SIZES[7] + 64);
+
+	fprintf(m_output, "{\n\t\"block_size\": %zu,\n\t\"results\": [", XORENC_FILE_BLOCK_SIZE);
+
+
+	// XOR at many sizes, with data and key misaligned by the same offset
+	for (lpp0=0; lpp0 < sizeof(SIZES) / sizeof(SIZES[0]); lpp0++) {
+		for (lpp1=0; lpp1 < sizeof(ALIGNMENTS) / sizeof(ALIGNMENTS[0]); lpp1++) {
+			arg.data   = &data[ALIGNMENTS[lpp1]];
+			arg.key    = &key[ALIGNMENTS[lpp1]];
+			arg.length = SIZES[lpp0];
+
+			snprintf(args, sizeof(args), "\"size\": %zu, \"alignment\": %zu", SIZES[lpp0], ALIGNMENTS[lpp1]);
+
+			m_Bench("encrypt_xor", args, m_BenchXOR, &arg, BENCH_SAMPLES, BENCH_SAMPLE_NS, SIZES[lpp0]);
+		}
+	}
+
+
+	// key loading, from file (one block) and as byte sequence
+	arg.key_str = m_CreateFile("key.bin", BENCH_DIRECT_SIZE, 0);
+	arg.block   = 1;
+
+	m_Bench("key_load", "\"source\": \"file\"", m_BenchKeyLoad, &arg, BENCH_SAMPLES, BENCH_SAMPLE_NS, XORENC_FILE_BLOCK_SIZE);
+
+	for (lpp0=0; lpp0 < 1024; lpp0++) {
+		sprintf(&key_bytes[lpp0 * 3], "%02X%s", (unsigned int)(lpp0 * 37) & 0xff, (lpp0 < 1023) ? " " : "");
+	}
+
+	arg.key_str = key_bytes;
+	arg.block   = 0;
+
+	m_Bench("key_load", "\"source\": \"byte_sequence\"", m_BenchKeyLoad, &arg, BENCH_SAMPLES, BENCH_SAMPLE_NS, 1024);
+
+
+	// writing a block to file
+	arg.data   = data;
+	arg.length = XORENC_FILE_BLOCK_SIZE;
+	arg.path   = m_CreateFile("write.bin", 0, 0);
+
+	m_Bench("write_to_file", "", m_BenchWrite, &arg, BENCH_SAMPLES, BENCH_SAMPLE_NS, XORENC_FILE_BLOCK_SIZE);
+
+
+	// KDFs, per derived block
+	arg.key_str = "#=~Kqv0^|@3a(S]eb,$}g-X!5(P4B>;$f7d30a5a1f9c1b0e2d4c3b8a7f6e5d4c3";
+
+	m_Bench("hash_argon2", "", m_BenchArgon2, &arg, BENCH_KDF_SAMPLES, 0, 0);
+	m_Bench("hash_scrypt", "", m_BenchScrypt, &arg, BENCH_KDF_SAMPLES, 0, 0);
+
+
+	// end-to-end runs on generated files
+	arg.path    = m_CreateFile("direct.bin", BENCH_DIRECT_SIZE, 1);
+	arg.key_str = m_CreateFile("key.bin", BENCH_DIRECT_SIZE, 0);
+
+	m_Bench("process_file", "\"mode\": \"direct\"", m_BenchProcessFile, &arg, BENCH_KDF_SAMPLES, 0, BENCH_DIRECT_SIZE);
+
+	arg.path    = m_CreateFile("derived.bin", BENCH_DERIVED_SIZE, 2);
+	arg.key_str = m_password;
+
+	m_Bench("process_file", "\"mode\": \"derived\"", m_BenchProcessFile, &arg, BENCH_KDF_SAMPLES, 0, BENCH_DERIVED_SIZE);
+
+	fprintf(m_output, "\n\t]\n}\n");
+
+	free(data);
+	free(key);
+
+	return 0;
+}
+
+/***************************************************/
+/* ---------------- Main function ---------------- */
+/***************************************************/
+int main(int argc, char* argv[]) {
+
+	const char* vectors_file = NULL;
+	const char* baseline     = NULL;
+	double      threshold    = 10;
+	bool        record       = false;
+	bool        bench        = true;
+	int         failures     = 0;
+	char        command[4200];
+	int         lpp0;
+
+	m_output = stdout;
+
+	for (lpp0=1; lpp0 < argc; lpp0++) {
+		if ((strcmp(argv[lpp0], "--vectors") == 0) && (lpp0+1 < argc)) {
+			vectors_file = argv[++lpp0];
+		}
+		else if ((strcmp(argv[lpp0], "--record-vectors") == 0) && (lpp0+1 < argc)) {
+			vectors_file = argv[++lpp0];
+			record       = true;
+		}
+		else if ((strcmp(argv[lpp0], "--baseline") == 0) && (lpp0+1 < argc)) {
+			baseline = argv[++lpp0];
+		}
+		else if ((strcmp(argv[lpp0], "--threshold") == 0) && (lpp0+1 < argc)) {
+			threshold = atof(argv[++lpp0]);
+		}
+		else if (strcmp(argv[lpp0], "--no-bench") == 0) {
+			bench = false;
+		}
+		else if ((argv[lpp0][0] != '-') && (m_output == stdout)) {
+			m_output = fopen(argv[lpp0], "w");
+		}
+		else {
+			fprintf(stderr, "Error: Invalid option \"%s\".\n", argv[lpp0]);
+
+			return 1;
+		}
+	}
+
+	if ((m_output == NULL) || (mkdtemp(m_temp_dir) == NULL)) {
+		fprintf(stderr, "Error: Could not create output or temporary folder.\n");
+
+		return 1;
+	}
+
+
+	// correctness first, a fast engine giving wrong output is worth nothing
+	if (vectors_file != NULL) {
+		int r = m_CheckVectors(vectors_file, record);
+
+		if (r != 0) {
+			fprintf(stderr, (r < 0) ? "Error: Could not read vectors \"%s\".\n" : "Error: Known-answer vectors failed (%s).\n", vectors_file);
+		}
+
+		failures += (r != 0);
+	}
+
+	if (bench && (failures == 0)) {
+		if (m_RunBenchmarks() < 0) {
+			fprintf(stderr, "Error: Could not allocate memory.\n");
+
+			failures += 1;
+		}
+	}
+
+	if (bench && (failures == 0) && (baseline != NULL)) {
+		int r = m_CompareBaseline(baseline, threshold);
+
+		if (r != 0) {
+			fprintf(stderr, (r < 0) ? "Error: Could not read baseline \"%s\".\n" : "Error: Slower than baseline \"%s\".\n", baseline);
+		}
+
+		failures += (r != 0);
+	}
+
+
+	// free used resources
+	snprintf(command, sizeof(command), "rm -r -f '%s'", m_temp_dir);
+
+	if (system(command) != 0) {
+		fprintf(stderr, "Warning: Could not remove \"%s\".\n", m_temp_dir);
+	}
+
+	if (m_output != stdout) {
+		fclose(m_output);
+	}
+
+	return (failures > 0) ? 1 : 0;
+}
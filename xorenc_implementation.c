@@ -1,4 +1,21 @@
 // Warning: Best read if using a monospaced/fixed-width font and tab width of 4.
+#include "xorenc.h"
+//---
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/random.h>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <endian.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
 
 /** ================================================================================
 
@@ -32,448 +49,3398 @@
 
 	================================================================================ */
 
-void XORenc_show_tips() {
+/** ----------------------------------------------------------------
 
-	fprintf(stderr, "\nFor maximum security, make sure you follow the instructions below:\n\n");
-	
-	fprintf(stderr, "\t1.Never use the same key/password to encrypt different files.\n");
-	fprintf(stderr, "\t2.Always use random/unpredictable keys/passwords to encrypt files.\n");
-	fprintf(stderr, "\t3.When using direct encryption mode, make sure the key is (at least) as long as the data being encrypted.\n");
+	Streaming context, used by 'XORenc_init/update/final'.
+
+	The keystream is addressed by position (bytes processed so far):
+	in direct mode it is the key itself (XOR'ed with every extra key,
+	each one a layer), in derived mode it is the chain of derived
+	blocks generated by 'XORenc_derive_block'.
+
+	---------------------------------------------------------------- */
+typedef struct {
+	uint8_t*      data;            // whole key (mapped key file or parsed byte sequence)
+	size_t        length;          // length of 'data' (in bytes)
+	bool          mapped;          // 'data' is a memory mapping of a key file
+	uint8_t*      tile;            // short key repeated to fill 'tile_length' (cyclic mode, see 'XORENC_KEY_TILE_SIZE')
+	size_t        tile_length;     // length of 'tile' (in bytes), a multiple of 'length'
+} TXORencLayer;
+
+struct TXORencContext {
+	TXORencParams params;          // parameters given to 'XORenc_init'
+	uint64_t      position;        // current keystream position (in bytes)
+	// direct mode
+	TXORencLayer* layers;          // key and extra keys, XOR'ed together
+	size_t        layer_count;     // number of items in 'layers'
+	size_t        key_length;      // length of shortest layer (in bytes)
+	// derived mode
+	char*         password;        // password used to derive the keystream
+	size_t        password_length; // length of 'password'
+	TXORencHash   block_key;       // derived key of block number 'block'
+	size_t        block;           // number of block held in 'block_key'
+	char          md5sum_1[(16*2)+1];
+	char          md5sum_2[(16*2)+1];
+	char*         md5sum[2];       // md5sum pair of 'block_key' (salt for next block)
+};
+
+// keys shorter than this are tiled in cyclic mode, so XOR runs over long stretches of (cached) key
+#define XORENC_KEY_TILE_SIZE (64 * 1024)
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_error_message:
+
+		Returns a description of an error code returned by the library functions.
+
+	---------------------------------------------------------------------------------------- */
+const char* XORenc_error_message(const int error) {
+
+	switch(error) {
+		case XORENC_ERROR_MEMORY:           return "Could not allocate memory.";
+		case XORENC_ERROR_PARAMS:           return "Invalid parameters.";
+		case XORENC_ERROR_KEY:              return "Key could not be loaded.";
+		case XORENC_ERROR_KEY_TOO_SHORT:    return "Key is shorter than the data being encrypted.";
+		case XORENC_ERROR_PASSWORD:         return "Password is too short.";
+		case XORENC_ERROR_KDF:              return "Key derivation failed.";
+		case XORENC_ERROR_INPUT:            return "Input could not be opened or read.";
+		case XORENC_ERROR_OUTPUT:           return "Output could not be created or written.";
+		case XORENC_ERROR_KDF_LIBRARY:      return "Key derivation library (libargon2/libscrypt) could not be loaded.";
+		case XORENC_ERROR_CHECKSUM:         return "Checksum does not match (data is corrupted or key is wrong).";
+		case XORENC_ERROR_COMPRESS_LIBRARY: return "Compression library (libzstd/liblz4) could not be loaded.";
+		default:                            return (error >= 0) ? "Success." : "Unknown error.";
+	}
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_write_to_file:
+	XORenc_layer_load:
 
-		Write buffer to file named 'filename'.
+		Load a direct key (key file or byte sequence) into a layer of context.
+
+		Raw regular key files are mapped; encoded key files and anything that can not be mapped
+		(e.g. a pipe given as '/dev/fd/N') are read whole and decoded in place, in one pass.
 
 	Parameters:
 
-		filename  -> Write file with this name. If filename is '-' then write to standard output (stdout).
-        
-		extension -> Extension of filename to be written (e.g. bmp, jpg, txt...).
+		layer  -> The layer to load key into.
+
+		key    -> Path to key file or byte sequence.
+
+		key_fd -> Descriptor of key file, used instead of opening 'key' (0 if not given; it is not closed).
+
+		params -> The parameters to be considered ('key_format' and 'cyclic_key').
 
-		buf       -> Pointer to data that will be written to file.
-        
-		buf_len   -> Length of input data (in bytes) to be written to file.
-        
-		overwrite -> Overwrite file if it exists?!
-        
-		std_out   -> Write file to standard output?
-        
 	Return value:
-    
+
 		Returns positive value or 0 if successful.
 
 	---------------------------------------------------------------------------------------- */
-int XORenc_write_to_file(const char* filename, const char* extension, const uint8_t* buf, const size_t buf_len, const bool overwrite, const bool std_out) {
+static int XORenc_layer_load(TXORencLayer* layer, const char* key, const int key_fd, const TXORencParams* params) {
 
-	FILE* fd1 = NULL;
+	struct stat key_stat;
+	int         fd0;
+	size_t      lpp0;
 
-	if (std_out == true) {
-		// write to stdout
-		fwrite(buf, 1, buf_len, stdout);
+	if ((key == NULL) || (key_fd < 0)) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	if (key_fd > 0) {
+		// descriptor given (e.g. passed by a client of daemon), a copy of it is used and closed like an opened file
+		fd0 = fcntl(key_fd, F_DUPFD_CLOEXEC, 0);
+
+		if (fd0 < 0) {
+			return XORENC_ERROR_KEY;
+		}
 	}
 	else {
-		// write to filename
-		char* out_filename = calloc(1, 4096);
-		
-		strcat(out_filename, filename);
-		
-		if (extension != NULL) {
-			strcat(out_filename, extension);
+		fd0 = open(key, O_RDONLY);
+	}
+
+	if ((fd0 >= 0) && ((fstat(fd0, &key_stat) != 0) || (S_ISDIR(key_stat.st_mode)))) {
+		close(fd0);
+
+		return XORENC_ERROR_KEY;
+	}
+
+	if ((fd0 >= 0) && ((params->key_format != XORENC_KEY_RAW) || (! S_ISREG(key_stat.st_mode)))) {
+		// read whole key (size of regular files is known, streams grow the buffer)
+		bool   sized    = (S_ISREG(key_stat.st_mode) && (key_stat.st_size > 0));
+		size_t capacity = (sized) ? (size_t)key_stat.st_size : 65536;
+		size_t length   = 0;
+		bool   failed   = false;
+
+		layer->data = malloc(capacity);
+
+		while (layer->data != NULL) {
+			ssize_t got;
+
+			if ((length == capacity) && (sized)) {
+				// whole key file was read
+				break;
+			}
+
+			if (length == capacity) {
+				uint8_t* grown = realloc(layer->data, capacity * 2);
+
+				if (grown == NULL) {
+					break;
+				}
+
+				layer->data  = grown;
+				capacity    *= 2;
+			}
+
+			got = read(fd0, &layer->data[length], capacity - length);
+
+			if ((got < 0) && (errno == EINTR)) {
+				continue;
+			}
+
+			if (got < 0) {
+				failed = true;
+			}
+
+			if (got <= 0) {
+				break;
+			}
+
+			length += got;
 		}
-		
-		if ((access(out_filename, R_OK) == 0) && (overwrite == false)) {
-			// file exists not overwriting it...
-			free(out_filename);
-			
-			return -1;
+
+		close(fd0);
+
+		// until decoded, whole buffer is wiped by 'XORenc_final' on failure
+		layer->length = length;
+
+		if ((layer->data == NULL) || (failed) || ((length == capacity) && (! sized))) {
+			// read failed, or buffer could not grow
+			return (layer->data == NULL) ? XORENC_ERROR_MEMORY : XORENC_ERROR_KEY;
 		}
-		
-		// write data to file
-		fd1 = fopen(out_filename, "a");
-		
-		// seek to the end of file
-		fseek(fd1, 0, SEEK_END);
-		
-		if (fd1 != NULL) {
-			size_t bytes_written = fwrite(buf, 1, buf_len, fd1);
-			
-			int close = fclose(fd1);
-			
-			if ((bytes_written != buf_len) || (close != 0)) {
-				free(out_filename);
-				
-				return -1;
-			}
+
+		if (params->key_format == XORENC_KEY_HEX) {
+			length = XORenc_hex_decode(layer->data, length);
 		}
-		else {
-			// failure while opening/creating file
-			free(out_filename);
-			
-			return -1;
+		else if (params->key_format == XORENC_KEY_BASE64) {
+			length = XORenc_base64_decode(layer->data, length);
 		}
+
+		if ((length == SIZE_MAX) || (length == 0)) {
+			return XORENC_ERROR_KEY;
+		}
+
+		// encoded text left after decoded key
+		memset(&layer->data[length], 0, layer->length - length);
+
+		layer->length = length;
 	}
-	
-	return 0;
+	else if (fd0 >= 0) {
+		// raw key file, map it as a whole so any position can be reached without copying
+		if (key_stat.st_size == 0) {
+			close(fd0);
+
+			return XORENC_ERROR_KEY;
+		}
+
+		layer->data = mmap(NULL, key_stat.st_size, PROT_READ, MAP_PRIVATE, fd0, 0);
+
+		close(fd0);
+
+		if (layer->data == MAP_FAILED) {
+			layer->data = NULL;
+
+			return XORENC_ERROR_KEY;
+		}
+
+		layer->length = key_stat.st_size;
+		layer->mapped = true;
+	}
+	else if (XORenc_key_is_byte_sequence(key) == true) {
+		// byte sequence of type: 'XX XX XX...', decoded here since it is known not to be a file
+		size_t length = strlen(key);
+
+		layer->data = malloc(length);
+
+		if (layer->data == NULL) {
+			return XORENC_ERROR_MEMORY;
+		}
+
+		memcpy(layer->data, key, length);
+
+		layer->length = length;
+		length        = XORenc_hex_decode(layer->data, length);
+
+		if ((length == SIZE_MAX) || (length == 0)) {
+			return XORENC_ERROR_KEY;
+		}
+
+		memset(&layer->data[length], 0, layer->length - length);
+
+		layer->length = length;
+	}
+	else {
+		return XORENC_ERROR_KEY;
+	}
+
+	if ((params->cyclic_key) && (layer->length < XORENC_KEY_TILE_SIZE)) {
+		// repeat key to the next multiple of its period past the tile size, so every phase still has a full tile ahead
+		layer->tile_length = ((XORENC_KEY_TILE_SIZE / layer->length) + 1) * layer->length;
+
+		if (posix_memalign((void**)&layer->tile, 64, layer->tile_length) != 0) {
+			layer->tile = NULL;
+
+			return XORENC_ERROR_MEMORY;
+		}
+
+		for (lpp0=0; lpp0 < layer->tile_length; lpp0 += layer->length) {
+			memcpy(&layer->tile[lpp0], layer->data, layer->length);
+		}
+	}
+
+	return XORENC_OK;
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_encrypt:
+	XORenc_init:
 
-		Perform encryption/decryption of input data from file.
+		Create a streaming context for encryption/decryption.
+
+		Data is then given (in as many pieces as wanted) to 'XORenc_update' and the context is
+		released with 'XORenc_final'. Feeding the same key with the same data splits in any other
+		way produces the same output as 'XORenc_encrypt'.
 
 	Parameters:
 
-		filename     -> Path to file to be encrypted. Must be NULL if input is to be read from standard input (stdin).
+		ctx    -> Where to store pointer to the new context.
+
+		key    -> Corresponds to key in one of the three available formats: path to file, byte sequence, or common string.
+
+		params -> The parameters to be applied.
 
-		key_filename -> Path to key file to be used for encryption, must not be NULL if encryption mode is direct and key is file.
-        
-		key_str      -> Input key as string, must be NULL if 'key_filename' is specified.
-        
-		params       -> The parameters to be applied.
-        
-		std_out      -> Output file to standard output (stdout)?
-        
 	Return value:
-    
+
 		Returns positive value or 0 if successful.
 
 	---------------------------------------------------------------------------------------- */
-int XORenc_encrypt(const char* filename, const char* key_filename, const char* key_str, const TXORencParams params, const bool std_out) {
+int XORenc_init(TXORencContext** ctx, const char* key, const TXORencParams params) {
 
-	FILE* fd0; // regular input file
+	TXORencContext* RESULT;
+	uint64_t        t0;
+	size_t          lpp0;
+	int             r;
 
-	uint8_t*       buf;         // file data buffer
-	size_t         buf_len;     // length of 'buf'
-	TXORencKey     key;         // key used to encrypt
-	const uint8_t* key_b;       // pointer to array of byte
-	size_t         file_size;   // size of input file (in bytes)
-	bool           EoF = false; // End of File reached?
-	char*          md5sum[2];   // Used for derived encryption in blocks
-	size_t         block = 0;   // number of block being encrypted
-	
-	// loop vars
-	size_t lpp0;
-	
-	/* ******* --- XORenc_encrypt --- ******* */
-	
-	if (filename != NULL) {
-		if (access(filename, R_OK) != 0) {
-			// specified input file does not exist or could not be accessed
-			return -500;
-		}
-	}
-	
-	if ((access(key_filename, R_OK) != 0) && (key_str == NULL) && (! XORenc_key_is_byte_sequence(key_filename))) {
-		// specified key file does not exist or could not be accessed
-		return -450;
-	}
-	
-	// open file
-	if (filename != NULL) {
-		fd0 = fopen(filename, "rb");
-	
-		if (fd0 == NULL) {
-			// could not open file
-			return -400;
-		}
-	}
-	// *** FREE: fd0
+	/* ******* --- XORenc_init --- ******* */
 
+	if ((ctx == NULL) || (key == NULL)) {
+		return XORENC_ERROR_PARAMS;
+	}
 
-	// allocate memory for file data buffer
-	buf = malloc(XORENC_FILE_BLOCK_SIZE);
+	*ctx = NULL;
 
-	if ((buf == NULL) && (filename != NULL)) {
-		fclose(fd0);
+	RESULT = calloc(1, sizeof(TXORencContext));
 
-		return -300;
+	if (RESULT == NULL) {
+		return XORENC_ERROR_MEMORY;
 	}
-	// *** FREE: fd0, buf
+
+	RESULT->params    = params;
+	RESULT->md5sum[0] = RESULT->md5sum_1;
+	RESULT->md5sum[1] = RESULT->md5sum_2;
+
+	t0 = XORenc_stats_begin(&params, XORENC_STAGE_KEY_LOAD);
 
 
 	switch(params.key_type) {
 		case Direct:
-			// read buffer; from regular file or standard input (stdin)?
-			if (filename != NULL) {
-				// read from regular file
-				buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, fd0);
+			if (params.extra_key_count >= XORENC_MAX_KEYS) {
+				free(RESULT);
+
+				return XORENC_ERROR_PARAMS;
 			}
-			else {
-				// read from standard input (stdin)
-				buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, stdin);
+
+			RESULT->layers = calloc(1 + params.extra_key_count, sizeof(TXORencLayer));
+
+			if (RESULT->layers == NULL) {
+				free(RESULT);
+
+				return XORENC_ERROR_MEMORY;
 			}
-			
-			// process whole file at once or in blocks?
-			if (buf_len < XORENC_FILE_BLOCK_SIZE) {
-				// whole file can be processed at once (TEST OK!)
-				key   = XORenc_key_load(key_filename, 0);
-				key_b = key.data;
-				
-				XORenc_encrypt_xor(buf, buf_len, key_b, buf_len);
-				
-				// write encrypted buffer to file
-				if (XORenc_write_to_file(filename, ".xen", buf, buf_len, false, std_out) < 0) {
-					// failed writing to file
-					free(key.data);
-					
-					if (filename != NULL) {
-						fclose(fd0);
-					}
-					
-					free(buf);
-					
-					return -250;
-				}
-				
-				// free used resources
-				free(key.data);
-			}
-			else while (EoF == false) {
-				// process file in blocks of 'XORENC_FILE_BLOCK_SIZE'
-				if ((block == 0) && (buf_len > 0)) {
-					// encrypt first block
-					key   = XORenc_key_load(key_filename, block);
-					key_b = key.data;
-					
-					XORenc_encrypt_xor(buf, buf_len, key_b, buf_len);
-					
-					// write encrypted buffer to file
-					if (XORenc_write_to_file(filename, ".xen", buf, buf_len, false, std_out) < 0) {
-						// failed writing to file
-						free(key.data);
-						
-						if (filename != NULL) {
-							fclose(fd0);
-						}
-						
-						free(buf);
-						
-						return -200;
-					}
-					
-					// go to next block
-					block += 1;
-					
-					// free used resources
-					free(key.data);
-				}
-				else if ((block > 0) && (buf_len > 0)) {
-					// encrypt second block onwards...
-					key   = XORenc_key_load(key_filename, block);
-					key_b = key.data;
-					
-					XORenc_encrypt_xor(buf, buf_len, key_b, buf_len);
-					
-					// write encrypted buffer to file
-					XORenc_write_to_file(filename, ".xen", buf, buf_len, true, std_out);
-					
-					// go to next block
-					block += 1;
-					
-					// free used resources
-					free(key.data);
-				}
-				
-				
-				if (filename != NULL) {
-					// read from regular file
-					buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, fd0);
-				}
-				else {
-					// read from standard input (stdin)
-					buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, stdin);
-				}
-				
-				
-				if (buf_len == 0) {
-					EoF = true;
+
+			for (lpp0=0; lpp0 < 1 + params.extra_key_count; lpp0++) {
+				// counted first, so 'XORenc_final' also releases a partially loaded layer
+				RESULT->layer_count += 1;
+
+				r = XORenc_layer_load(&RESULT->layers[lpp0], (lpp0 == 0) ? key : params.extra_keys[lpp0 - 1], (lpp0 == 0) ? params.key_fd : 0, &params);
+
+				if (r < 0) {
+					XORenc_final(RESULT);
+
+					return r;
 				}
+
+				RESULT->key_length = ((lpp0 == 0) || (RESULT->layers[lpp0].length < RESULT->key_length)) ? RESULT->layers[lpp0].length : RESULT->key_length;
 			}
+
+			XORenc_stats_end(&params, XORENC_STAGE_KEY_LOAD, t0);
 		break;
 
 
 		case Derived:
-			if ((key_str == NULL) || (strlen(key_str) == 0)) {
-				// invalid key was given
-				if (filename != NULL) {
-					fclose(fd0);
-				}
-				
-				free(buf);
-				
-				return -150;
-			}
-			
-			
-			// read buffer; from regular file or standard input (stdin)?
-			if (filename != NULL) {
-				// read from regular file
-				buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, fd0);
+			if ((params.extra_key_count > 0) || (params.key_fd != 0)) {
+				// extra keys and key files are direct keys only
+				free(RESULT);
+
+				return XORENC_ERROR_PARAMS;
 			}
-			else {
-				// read from standard input (stdin)
-				buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, stdin);
+
+			if (strlen(key) < XORENC_MIN_PASSWORD_LENGTH) {
+				free(RESULT);
+
+				return XORENC_ERROR_PASSWORD;
 			}
 
+			if (XORenc_kdf_load() < 0) {
+				free(RESULT);
 
-			if (buf_len < XORENC_FILE_BLOCK_SIZE) {
-				// process whole file at once...
-				// encrypt first block
-				XORenc_encrypt_derived_first(buf, buf_len, key_str, strlen(key_str), NULL);
-				
-				// write encrypted data to file...
-				if (XORenc_write_to_file(filename, ".xen", buf, buf_len, false, std_out) < 0) {
-					// failed writing to file
-					if (filename != NULL) {
-						fclose(fd0);
-					}
-  			  
-					free(buf);
-  			  
-					return -100;
-				}
+				return XORENC_ERROR_KDF_LIBRARY;
 			}
-			else while (EoF == false) {
-				// process in blocks until end of file...
-				if ((block == 0) && (buf_len > 0)) {
-					// first block
-					md5sum[0] = calloc(1, (16*2)+1);
-					md5sum[1] = calloc(1, (16*2)+1);
-
-					// encrypt first block
-					XORenc_encrypt_derived_first(buf, buf_len, key_str, strlen(key_str), md5sum);
-					
-					// write encrypted block to file
-					if (XORenc_write_to_file(filename, ".xen", buf, buf_len, false, std_out) < 0) {
-						free(md5sum[0]);
-						free(md5sum[1]);
-
-						if (filename != NULL) {
-							fclose(fd0);
-						}
-						
-						free(buf);
-						
-						return -50;
-					}
-					
-					block += 1;
-				}
-				else if ((block > 0) && (buf_len > 0)) {
-					// second block onwards; encrypt this block...
-					XORenc_encrypt_derived_next(md5sum, buf, buf_len, key_str, strlen(key_str), md5sum);
-
-					// write to file
-					XORenc_write_to_file(filename, ".xen", buf, buf_len, true, std_out);
-					
-					block += 1;
-				}
-				
-				
-				if (EoF == true) {
-					free(md5sum[0]);
-					free(md5sum[1]);
-				}
-				
-				
-				// read next block (if any)
-				if (filename != NULL) {
-					// read from regular file
-					buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, fd0);
-				}
-				else {
-					// read from standard input (stdin)
-					buf_len = fread(buf, 1, XORENC_FILE_BLOCK_SIZE, stdin);
-				}
-				
-				
-				if (buf_len == 0) {
-					EoF = true;
-				}
+
+			RESULT->password        = strdup(key);
+			RESULT->password_length = strlen(key);
+
+			if (RESULT->password == NULL) {
+				free(RESULT);
+
+				return XORENC_ERROR_MEMORY;
 			}
 		break;
 
 
 		default:
-			// free resources used
-			if (filename != NULL) {
-				fclose(fd0);
-			}
-			
-			free(buf);
-		break;
+			free(RESULT);
+
+			return XORENC_ERROR_PARAMS;
 	}
 
+	*ctx = RESULT;
 
-	if (filename != NULL) {
-		fclose(fd0);
-	}
-	
-	free(buf);
-	
-	return 0;
+	return XORENC_OK;
 }
 
 /** ----------------------------------------------------------------------------------------
 
-	XORenc_process_file:
+	XORenc_keystream:
 
-		Process input file according to given parameters.
+		Get pointers to keystream at context's current position, one per layer in direct
+		mode (they are all XOR'ed into the data) and a single one in derived mode.
 
 	Parameters:
 
-		filename -> Path to file to be encrypted. Must be NULL if input is to be read from standard input (stdin).
+		ctx    -> The context.
+
+		keys   -> Where to store pointers to keystream ('XORENC_MAX_KEYS' items).
+
+		count  -> Where to store number of pointers stored in 'keys'.
+
+		length -> Where to store how many bytes are available from every one of 'keys' onwards.
 
-		key      -> Corresponds to key in one of the three available formats: path to file, byte sequence, or common string.
-        
-		std_out  -> Output file to standard output (stdout)?
-        
-		params   -> The parameters to be considered.
-        
 	Return value:
 
 		Returns positive value or 0 if successful.
 
 	---------------------------------------------------------------------------------------- */
-int XORenc_process_file(const char* filename, const char* key, const bool std_out, const TXORencParams params) {
+static int XORenc_keystream(TXORencContext* ctx, const uint8_t** keys, size_t* count, size_t* length) {
 
-	int r = -1;
+	size_t block  = ctx->position / XORENC_FILE_BLOCK_SIZE;
+	size_t offset = ctx->position % XORENC_FILE_BLOCK_SIZE;
+	size_t lpp0;
 
+	if (ctx->params.key_type == Direct) {
+		if ((! ctx->params.cyclic_key) && (ctx->position >= ctx->key_length)) {
+			return XORENC_ERROR_KEY_TOO_SHORT;
+		}
 
-	if ((access(key, R_OK) == 0) && (params.key_type == Direct)) {
-		// file exists, key is path to key file
-		r = XORenc_encrypt(filename, key, NULL, params, std_out);
-	}
-	else if ((XORenc_key_is_byte_sequence(key) == true) && (params.key_type == Direct)) {
-		// key refers to a sequence of bytes as string, in the form: 'XX XX XX...'
-		r = XORenc_encrypt(filename, key, NULL, params, std_out);
-	}
-	else if (params.key_type == Derived) {
-		// key is a common password
-		r = XORenc_encrypt(filename, NULL, key, params, std_out);
-	}
+		*count  = ctx->layer_count;
+		*length = SIZE_MAX;
 
+		for (lpp0=0; lpp0 < ctx->layer_count; lpp0++) {
+			TXORencLayer* layer = &ctx->layers[lpp0];
+			size_t        available;
 
-	if ((r >= 0) && (filename != NULL)) {
-		// input was from regular file
-		fprintf(stderr, "\nFile: \"%s\" en/de-crypted successfully! :)\n", filename);
-		
-		XORenc_show_tips();
+			if (ctx->params.cyclic_key) {
+				// keystream repeats with the period of the key, keep its phase
+				size_t phase = ctx->position % layer->length;
+
+				keys[lpp0] = (layer->tile != NULL) ? &layer->tile[phase] : &layer->data[phase];
+				available  = ((layer->tile != NULL) ? layer->tile_length : layer->length) - phase;
+			}
+			else {
+				keys[lpp0] = &layer->data[ctx->position];
+				available  = layer->length - ctx->position;
+			}
+
+			*length = (available < *length) ? available : *length;
+		}
+
+		return XORENC_OK;
 	}
-	else if ((r >= 0) && (filename == NULL)) {
-		// input was from standard input (stdin)
-		fprintf(stderr, "\nFile en/de-crypted successfully! :)\n");
-		
-		XORenc_show_tips();
+
+
+	// derived mode; regenerate the chain from the first block if going backwards
+	if ((ctx->block_key.data != NULL) && (block < ctx->block)) {
+		explicit_bzero(ctx->block_key.data, ctx->block_key.length);
+		free(ctx->block_key.data);
+
+		ctx->block_key.data = NULL;
 	}
-	else if (r < 0) {
-		fprintf(stderr, "\nError (%d) occurred while processing file. :(\n", r);
+
+	while ((ctx->block_key.data == NULL) || (ctx->block < block)) {
+		TXORencHash next;
+
+		if (ctx->block_key.data == NULL) {
+			// encrypt first block
+			next       = XORenc_derive_block(ctx->password, ctx->password_length, NULL, ctx->md5sum, &ctx->params);
+			ctx->block = 0;
+		}
+		else {
+			// second block onwards
+			next        = XORenc_derive_block(ctx->password, ctx->password_length, ctx->md5sum, ctx->md5sum, &ctx->params);
+			ctx->block += 1;
+
+			explicit_bzero(ctx->block_key.data, ctx->block_key.length);
+			free(ctx->block_key.data);
+		}
+
+		ctx->block_key = next;
+
+		if (ctx->block_key.data == NULL) {
+			return XORENC_ERROR_KDF;
+		}
+	}
+
+	keys[0] = &ctx->block_key.data[offset];
+	*count  = 1;
+	*length = ctx->block_key.length - offset;
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_update:
+
+		Encrypt/decrypt next piece of data (in place) and advance keystream position.
+
+	Parameters:
+
+		ctx      -> The context created by 'XORenc_init'.
+
+		data     -> Pointer to data to be encrypted/decrypted.
+
+		data_len -> Length of input data (in bytes).
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_update(TXORencContext* ctx, uint8_t* data, const size_t data_len) {
+
+	const uint8_t* keys[XORENC_MAX_KEYS];
+	size_t         key_count;
+	size_t         key_len;
+	size_t         done = 0;
+
+	if ((ctx == NULL) || ((data == NULL) && (data_len > 0))) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	if ((ctx->params.key_type == Direct) && (! ctx->params.cyclic_key) && (ctx->position + data_len > ctx->key_length)) {
+		// check before touching the data, so it is never left half encrypted
+		return XORENC_ERROR_KEY_TOO_SHORT;
+	}
+
+	while (done < data_len) {
+		int r = XORenc_keystream(ctx, keys, &key_count, &key_len);
+
+		if (r < 0) {
+			return r;
+		}
+
+		if (key_len > data_len - done) {
+			key_len = data_len - done;
+		}
+
+		uint64_t t0 = XORenc_stats_begin(&ctx->params, XORENC_STAGE_XOR);
+
+		if (key_count == 1) {
+			XORenc_encrypt_xor(&data[done], key_len, keys[0], key_len);
+		}
+		else {
+			XORenc_encrypt_xor_multi(&data[done], key_len, keys, key_count);
+		}
+
+		XORenc_stats_end(&ctx->params, XORENC_STAGE_XOR, t0);
+
+		done          += key_len;
+		ctx->position += key_len;
+	}
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_update_iov:
+
+		Encrypt/decrypt a scatter-gather list of caller owned buffers (in place) and advance
+		keystream position, as if the buffers were given to 'XORenc_update' one after another.
+
+		No data is copied and no memory is allocated (except for generating a new derived block,
+		which happens once every 'XORENC_FILE_BLOCK_SIZE' bytes in derived mode).
+
+	Parameters:
+
+		ctx    -> The context created by 'XORenc_init'.
+
+		iov    -> Array of buffers to be encrypted/decrypted.
+
+		iovcnt -> Number of items in 'iov'.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_update_iov(TXORencContext* ctx, const struct iovec* iov, const int iovcnt) {
+
+	uint64_t total = 0;
+	int      lpp0;
+
+	if ((ctx == NULL) || ((iov == NULL) && (iovcnt > 0)) || (iovcnt < 0)) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	for (lpp0=0; lpp0 < iovcnt; lpp0++) {
+		total += iov[lpp0].iov_len;
+	}
+
+	if ((ctx->params.key_type == Direct) && (! ctx->params.cyclic_key) && (ctx->position + total > ctx->key_length)) {
+		// check before touching any buffer, so they are never left half encrypted
+		return XORENC_ERROR_KEY_TOO_SHORT;
+	}
+
+	for (lpp0=0; lpp0 < iovcnt; lpp0++) {
+		int r = XORenc_update(ctx, iov[lpp0].iov_base, iov[lpp0].iov_len);
+
+		if (r < 0) {
+			return r;
+		}
+	}
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_seek:
+
+		Set keystream position of context, the next 'XORenc_update' starts from there.
+
+		In direct mode 'position' is the offset in the key (modulo its length when 'cyclic_key'
+		is set). In derived mode it is 'block * XORENC_FILE_BLOCK_SIZE + offset'; going back to
+		an earlier block regenerates the chain of derived blocks from the first one.
+
+	Parameters:
+
+		ctx      -> The context created by 'XORenc_init'.
+
+		position -> The new keystream position (in bytes).
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_seek(TXORencContext* ctx, const uint64_t position) {
+
+	if (ctx == NULL) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	if ((ctx->params.key_type == Direct) && (! ctx->params.cyclic_key) && (position > ctx->key_length)) {
+		return XORENC_ERROR_KEY_TOO_SHORT;
+	}
+
+	ctx->position = position;
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_final:
+
+		Release context and every resource held by it (key material is wiped).
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_final(TXORencContext* ctx) {
+
+	size_t lpp0;
+
+	if (ctx == NULL) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	for (lpp0=0; lpp0 < ctx->layer_count; lpp0++) {
+		TXORencLayer* layer = &ctx->layers[lpp0];
+
+		if (layer->mapped) {
+			munmap(layer->data, layer->length);
+		}
+		else if (layer->data != NULL) {
+			explicit_bzero(layer->data, layer->length);
+			free(layer->data);
+		}
+
+		if (layer->tile != NULL) {
+			explicit_bzero(layer->tile, layer->tile_length);
+			free(layer->tile);
+		}
+	}
+
+	free(ctx->layers);
+
+	if (ctx->password != NULL) {
+		explicit_bzero(ctx->password, ctx->password_length);
+		free(ctx->password);
+	}
+
+	if (ctx->block_key.data != NULL) {
+		explicit_bzero(ctx->block_key.data, ctx->block_key.length);
+		free(ctx->block_key.data);
+	}
+
+	free(ctx);
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_throttle:
+
+		Token bucket limiting a transfer (read or write path) to 'rate' bytes/sec; waits
+		until 'bytes' may be transferred. Unused time is not saved up for later, so a burst
+		is at most one block.
+
+	Parameters:
+
+		next  -> When the next transfer may start (see 'XORenc_clock', 0 at first call).
+
+		rate  -> Bytes per second (0->unlimited).
+
+		bytes -> Bytes about to be transferred.
+
+	---------------------------------------------------------------------------------------- */
+static void XORenc_throttle(uint64_t* next, const uint64_t rate, const size_t bytes) {
+
+	uint64_t now;
+
+	if (rate == 0) {
+		return;
+	}
+
+	now = XORenc_clock();
+
+	if (*next > now) {
+		struct timespec wait = { (*next - now) / 1000000000, (*next - now) % 1000000000 };
+
+		while ((nanosleep(&wait, &wait) != 0) && (errno == EINTR));
+
+		now = *next;
+	}
+
+	*next = now + (((uint64_t)bytes * 1000000000) / rate);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_blocks:
+
+		Get number of blocks ('XORENC_FILE_BLOCK_SIZE') that start within a piece of data, so
+		'TXORencStats.blocks' counts the same whatever size of read/write requests is used.
+
+	Parameters:
+
+		position -> Position of piece (in bytes, from start of processing).
+
+		length   -> Length of piece (in bytes).
+
+	---------------------------------------------------------------------------------------- */
+static uint64_t XORenc_blocks(const uint64_t position, const uint64_t length) {
+
+	return ((position + length + XORENC_FILE_BLOCK_SIZE - 1) / XORENC_FILE_BLOCK_SIZE) - ((position + XORENC_FILE_BLOCK_SIZE - 1) / XORENC_FILE_BLOCK_SIZE);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_read_full:
+
+		Read from file descriptor until 'buf_len' bytes were read or end of file is reached.
+
+	Return value:
+
+		Returns number of bytes read (less than 'buf_len' only at end of file), or -1 on error.
+
+	---------------------------------------------------------------------------------------- */
+static ssize_t XORenc_read_full(const int fd, uint8_t* buf, const size_t buf_len) {
+
+	size_t done = 0;
+
+	while (done < buf_len) {
+		ssize_t r = read(fd, &buf[done], buf_len - done);
+
+		if (r == 0) {
+			break;
+		}
+		else if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -1;
+		}
+
+		done += r;
+	}
+
+	return done;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_write_full:
+
+		Write 'buf_len' bytes to file descriptor.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_write_full(const int fd, const uint8_t* buf, const size_t buf_len) {
+
+	size_t done = 0;
+
+	while (done < buf_len) {
+		ssize_t r = write(fd, &buf[done], buf_len - done);
+
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return -1;
+		}
+
+		done += r;
+	}
+
+	return 0;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_write_to_file:
+
+		Write buffer to file named 'filename'.
+
+	Parameters:
+
+		filename  -> Write file with this name. If filename is '-' then write to standard output (stdout).
+        
+		extension -> Extension of filename to be written (e.g. bmp, jpg, txt...).
+
+		buf       -> Pointer to data that will be written to file.
+        
+		buf_len   -> Length of input data (in bytes) to be written to file.
+        
+		overwrite -> Overwrite file if it exists?!
+        
+		std_out   -> Write file to standard output?
+        
+	Return value:
+    
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_write_to_file(const char* filename, const char* extension, const uint8_t* buf, const size_t buf_len, const bool overwrite, const bool std_out) {
+
+	char*  out_filename;
+	size_t filename_len;
+	size_t extension_len;
+	int    fd1;
+	int    r;
+
+	if (std_out == true) {
+		// write to stdout
+		if (fwrite(buf, 1, buf_len, stdout) != buf_len) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+
+	// write to filename
+	filename_len  = strlen(filename);
+	extension_len = (extension != NULL) ? strlen(extension) : 0;
+	out_filename  = malloc(filename_len + extension_len + 1);
+
+	if (out_filename == NULL) {
+		return -1;
+	}
+
+	memcpy(out_filename, filename, filename_len);
+
+	if (extension != NULL) {
+		memcpy(&out_filename[filename_len], extension, extension_len);
+	}
+
+	out_filename[filename_len + extension_len] = '\0';
+
+	// not overwriting, creation fails if file exists (checked in the same call, no 'access' before it)
+	fd1 = open(out_filename, (overwrite) ? (O_WRONLY | O_CREAT | O_APPEND) : (O_WRONLY | O_CREAT | O_EXCL), 0666);
+
+	free(out_filename);
+
+	if (fd1 < 0) {
+		// file exists, or failure while opening/creating it
+		return -1;
+	}
+
+	r = XORenc_write_full(fd1, buf, buf_len);
+
+	if ((close(fd1) != 0) || (r < 0)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/** ----------------------------------------------------------------
+
+	Compressed stream, see 'XORenc_encrypt_compressed'.
+
+	Data is compressed block by block ('XORENC_FILE_BLOCK_SIZE')
+	before it is XOR'ed; everything below is encrypted:
+
+		"XENCMP01"        (8 bytes)
+		algorithm         (1 byte, 'TXORencCompression')
+		reserved          (7 bytes, 0)
+
+	then a record for every block:
+
+		compressed length (4 bytes)
+		data length       (4 bytes)
+		compressed data   (block as it is if it does not shrink,
+		                   both lengths are equal then)
+
+	and a record with both lengths 0 at the end. All numbers are
+	little endian.
+
+	---------------------------------------------------------------- */
+typedef struct {
+	char    magic[8]; // "XENCMP01"
+	uint8_t algo;     // 'TXORencCompression'
+	uint8_t reserved[7];
+} TXORencCompressHeader;
+
+typedef struct {
+	uint32_t packed_length; // length of compressed data
+	uint32_t length;        // length of data
+} TXORencCompressRecord;
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_is_compressed:
+
+		Check if input starts with the (encrypted) header of a compressed stream. Context is
+		left at keystream position 0 (a derived block generated for it is kept).
+
+	Parameters:
+
+		ctx      -> The context created by 'XORenc_init'.
+
+		head     -> Beginning of input.
+
+		head_len -> Length of 'head' (in bytes).
+
+	---------------------------------------------------------------------------------------- */
+static bool XORenc_is_compressed(TXORencContext* ctx, const uint8_t* head, const size_t head_len) {
+
+	TXORencCompressHeader header;
+	bool                  RESULT;
+
+	if (head_len < sizeof(header)) {
+		return false;
+	}
+
+	memcpy(&header, head, sizeof(header));
+
+	RESULT = (XORenc_update(ctx, (uint8_t*)&header, sizeof(header)) >= 0) && (memcmp(header.magic, "XENCMP01", 8) == 0);
+
+	return (XORenc_seek(ctx, 0) >= 0) && (RESULT);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_compress_stream:
+
+		Body of 'XORenc_encrypt_compressed', with a context at keystream position 0 and the
+		beginning of input that may already have been read by the caller.
+
+	Parameters:
+
+		ctx       -> The context created by 'XORenc_init'.
+
+		in_fd     -> File descriptor of input data (following 'head').
+
+		out_fd    -> File descriptor to write output to.
+
+		algo      -> The compression algorithm used when encrypting ('XORENC_COMPRESS_NONE' only
+		             decrypts, input that is not a compressed stream is an error then).
+
+		head      -> Beginning of input already read (may be NULL if 'head_len' is 0).
+
+		head_read -> Length of 'head' (at most the size of the header, in bytes).
+
+		params    -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_compress_stream(TXORencContext* ctx, const int in_fd, const int out_fd, const TXORencCompression algo, const uint8_t* head, const size_t head_read, const TXORencParams params) {
+
+	TXORencCompressHeader header;
+	TXORencCompressRecord record;
+	TXORencCompression    used       = algo;
+	TXORencStats*         stats      = params.stats;
+	uint8_t*              buf        = malloc(XORENC_FILE_BLOCK_SIZE);
+	uint8_t*              packed     = NULL;
+	size_t                packed_cap = 0;
+	size_t                head_len   = 0; // bytes of input already in 'buf' (compressing)
+	uint64_t              t0;
+	uint64_t              read_next  = 0; // see 'XORenc_throttle'
+	uint64_t              write_next = 0;
+	ssize_t               buf_len;
+	bool                  decrypting = false;
+	int                   r          = XORENC_OK;
+
+	/* ******* --- XORenc_compress_stream --- ******* */
+
+	if ((buf == NULL) || (head_read > sizeof(header))) {
+		free(buf);
+
+		return (buf == NULL) ? XORENC_ERROR_MEMORY : XORENC_ERROR_PARAMS;
+	}
+	// *** FREE: buf, packed
+
+
+	// beginning of input tells the direction, keep it as it is in case it must be compressed
+	if (head_read > 0) {
+		memcpy(buf, head, head_read);
+	}
+
+	t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+	buf_len = XORenc_read_full(in_fd, &buf[head_read], sizeof(header) - head_read);
+
+	XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+	r = (buf_len < 0) ? XORENC_ERROR_INPUT : r;
+
+	if (r >= 0) {
+		head_len = head_read + buf_len;
+
+		memcpy(&header, buf, head_len);
+
+		r = XORenc_update(ctx, (uint8_t*)&header, head_len);
+	}
+
+	if (r >= 0) {
+		decrypting = ((head_len == sizeof(header)) && (memcmp(header.magic, "XENCMP01", 8) == 0));
+
+		if (decrypting) {
+			used     = (TXORencCompression)header.algo;
+			head_len = 0;
+
+			if (stats != NULL) {
+				stats->bytes_in += sizeof(header);
+			}
+		}
+		else if (algo == XORENC_COMPRESS_NONE) {
+			// only decrypting
+			r = XORENC_ERROR_INPUT;
+		}
+		else {
+			// plaintext, encrypt header instead
+			memcpy(header.magic, "XENCMP01", 8);
+			memset(header.reserved, 0, sizeof(header.reserved));
+
+			header.algo = (uint8_t)algo;
+			r           = XORenc_seek(ctx, 0);
+		}
+	}
+
+	if (r >= 0) {
+		r = XORenc_compress_load(used);
+	}
+
+	if (r >= 0) {
+		packed_cap = sizeof(record) + XORenc_compress_bound(used, XORENC_FILE_BLOCK_SIZE);
+		packed     = malloc(packed_cap);
+		r          = (packed == NULL) ? XORENC_ERROR_MEMORY : r;
+	}
+
+	if ((r >= 0) && (! decrypting)) {
+		r = XORenc_update(ctx, (uint8_t*)&header, sizeof(header));
+
+		if ((r >= 0) && (XORenc_write_full(out_fd, (const uint8_t*)&header, sizeof(header)) < 0)) {
+			r = XORENC_ERROR_OUTPUT;
+		}
+
+		if ((r >= 0) && (stats != NULL)) {
+			stats->bytes_out += sizeof(header);
+		}
+	}
+
+
+	while ((r >= 0) && (! decrypting)) {
+		size_t packed_len;
+
+		XORenc_throttle(&read_next, params.bwlimit, XORENC_FILE_BLOCK_SIZE - head_len);
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = XORenc_read_full(in_fd, &buf[head_len], XORENC_FILE_BLOCK_SIZE - head_len);
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if (buf_len < 0) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		buf_len += head_len;
+		head_len = 0;
+
+		if (buf_len > 0) {
+			t0         = XORenc_stats_begin(&params, XORENC_STAGE_COMPRESS);
+			packed_len = XORenc_compress(used, buf, buf_len, &packed[sizeof(record)], packed_cap - sizeof(record));
+
+			XORenc_stats_end(&params, XORENC_STAGE_COMPRESS, t0);
+
+			if (packed_len >= (size_t)buf_len) {
+				// does not shrink (or could not be compressed), store it
+				memcpy(&packed[sizeof(record)], buf, buf_len);
+
+				packed_len = buf_len;
+			}
+		}
+		else {
+			// end of input, last record is empty
+			packed_len = 0;
+		}
+
+		record.packed_length = htole32((uint32_t)packed_len);
+		record.length        = htole32((uint32_t)buf_len);
+
+		memcpy(packed, &record, sizeof(record));
+
+		r = XORenc_update(ctx, packed, sizeof(record) + packed_len);
+
+		if (r < 0) {
+			break;
+		}
+
+		XORenc_throttle(&write_next, params.bwlimit, sizeof(record) + packed_len);
+
+		t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+		if (XORenc_write_full(out_fd, packed, sizeof(record) + packed_len) < 0) {
+			r = XORENC_ERROR_OUTPUT;
+
+			break;
+		}
+
+		XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+
+		if (stats != NULL) {
+			stats->bytes_in  += buf_len;
+			stats->bytes_out += sizeof(record) + packed_len;
+			stats->blocks    += (buf_len > 0) ? 1 : 0; // a record holds one block of uncompressed data
+		}
+
+		if (buf_len == 0) {
+			break;
+		}
+	}
+
+
+	while ((r >= 0) && (decrypting)) {
+		const uint8_t* data;
+		size_t         packed_len;
+		size_t         data_len;
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = XORenc_read_full(in_fd, (uint8_t*)&record, sizeof(record));
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if ((buf_len < 0) || ((size_t)buf_len != sizeof(record))) {
+			// truncated
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		r = XORenc_update(ctx, (uint8_t*)&record, sizeof(record));
+
+		if (r < 0) {
+			break;
+		}
+
+		packed_len = le32toh(record.packed_length);
+		data_len   = le32toh(record.length);
+
+		if ((data_len > XORENC_FILE_BLOCK_SIZE) || (packed_len > packed_cap) || ((data_len == 0) != (packed_len == 0))) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		if (data_len == 0) {
+			// end of stream, nothing may follow
+			r = (XORenc_read_full(in_fd, buf, 1) == 0) ? r : XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		XORenc_throttle(&read_next, params.bwlimit, packed_len);
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = XORenc_read_full(in_fd, packed, packed_len);
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if ((buf_len < 0) || ((size_t)buf_len != packed_len)) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		r = XORenc_update(ctx, packed, packed_len);
+
+		if (r < 0) {
+			break;
+		}
+
+		data = packed;
+
+		if (packed_len != data_len) {
+			t0   = XORenc_stats_begin(&params, XORENC_STAGE_COMPRESS);
+			data = buf;
+
+			if (XORenc_decompress(used, packed, packed_len, buf, XORENC_FILE_BLOCK_SIZE) != data_len) {
+				r = XORENC_ERROR_INPUT;
+
+				break;
+			}
+
+			XORenc_stats_end(&params, XORENC_STAGE_COMPRESS, t0);
+		}
+
+		XORenc_throttle(&write_next, params.bwlimit, data_len);
+
+		t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+		if (XORenc_write_full(out_fd, data, data_len) < 0) {
+			r = XORENC_ERROR_OUTPUT;
+
+			break;
+		}
+
+		XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+
+		if (stats != NULL) {
+			stats->bytes_in  += sizeof(record) + packed_len;
+			stats->bytes_out += data_len;
+			stats->blocks    += 1; // a record holds one block of uncompressed data
+		}
+	}
+
+
+	free(buf);
+	free(packed);
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_compressed:
+
+		En/de-crypt with compression; data is compressed before it is XOR'ed, so less
+		keystream is used (and, in derived mode, fewer blocks are derived).
+
+		The direction is told by the input: if it starts with the (decrypted) header of a
+		compressed stream it is decrypted and decompressed, with the algorithm named in the
+		header; otherwise it is compressed with 'algo' and encrypted. Input is read as a
+		stream, so it can be a pipe. ('XORenc_encrypt' detects compressed streams as well.)
+
+	Parameters:
+
+		in_fd  -> File descriptor of input data.
+
+		out_fd -> File descriptor to write output to.
+
+		key    -> Path to key file, byte sequence or password, according to 'params.key_type'.
+
+		algo   -> The compression algorithm used when encrypting ('XORENC_COMPRESS_NONE' only
+		          decrypts).
+
+		params -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful, 'XORENC_ERROR_INPUT' if compressed data is
+		invalid (it is corrupted or the key is wrong).
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_compressed(const int in_fd, const int out_fd, const char* key, const TXORencCompression algo, const TXORencParams params) {
+
+	TXORencContext* ctx;
+	TXORencStats*   stats   = params.stats;
+	uint64_t        t_total = XORenc_clock();
+	int             r;
+
+	/* ******* --- XORenc_encrypt_compressed --- ******* */
+
+	r = XORenc_init(&ctx, key, params);
+
+	if (r >= 0) {
+		r = XORenc_compress_stream(ctx, in_fd, out_fd, algo, NULL, 0, params);
+
+		XORenc_final(ctx);
+	}
+
+	if ((stats != NULL) || (params.trace != NULL)) {
+		uint64_t t_end = XORenc_clock();
+
+		if (stats != NULL) {
+			stats->total_ns += t_end - t_total;
+		}
+
+		XORenc_trace_event(params.trace, "file", t_total, t_end);
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_write_output:
+
+		Write en/de-crypted data of 'XORenc_encrypt' to '<filename>.xen', or to numbered parts
+		'<filename>.xen.000', '.001'... of 'params.split_size' bytes each (data is split where
+		it crosses a part boundary, so every part is complete once it is left behind).
+
+	Parameters:
+
+		filename -> Path to input file.
+
+		buf      -> Pointer to data.
+
+		buf_len  -> Length of data (in bytes).
+
+		position -> Position of data in output (0 creates output, anything else appends to it).
+
+		std_out  -> Write to standard output (stdout)? Output is never split then.
+
+		params   -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_write_output(const char* filename, const uint8_t* buf, const size_t buf_len, const uint64_t position, const bool std_out, const TXORencParams* params) {
+
+	char   extension[32];
+	size_t done = 0;
+
+	if ((params->split_size == 0) || (std_out)) {
+		return XORenc_write_to_file(filename, ".xen", buf, buf_len, (position > 0), std_out);
+	}
+
+	// an empty input still creates the first part
+	do {
+		uint64_t offset = (position + done) % params->split_size; // offset in part
+		size_t   piece  = ((buf_len - done) < (params->split_size - offset)) ? (buf_len - done) : (size_t)(params->split_size - offset);
+
+		snprintf(extension, sizeof(extension), ".xen.%03" PRIu64, (position + done) / params->split_size);
+
+		if (XORenc_write_to_file(filename, extension, &buf[done], piece, (offset > 0), false) < 0) {
+			return -1;
+		}
+
+		done += piece;
+	} while (done < buf_len);
+
+	return 0;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_small:
+
+		Fast path of 'XORenc_encrypt' for a regular file smaller than a block: buffer is sized
+		to the file, which is read with one call and written with one call ('stat' was
+		already done by the caller).
+
+	Parameters:
+
+		in_fd    -> File descriptor of input file.
+
+		in_len   -> Size of input file (less than 'XORENC_FILE_BLOCK_SIZE').
+
+		ctx      -> The context created by 'XORenc_init'.
+
+		filename -> Path to input file ('.xen' is appended for output).
+
+		std_out  -> Output file to standard output (stdout)?
+
+		params   -> The parameters to be applied.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_encrypt_small(const int in_fd, const size_t in_len, TXORencContext* ctx, const char* filename, const bool std_out, const TXORencParams* params) {
+
+	uint8_t* buf = malloc((in_len > 0) ? in_len : 1);
+	ssize_t  buf_len;
+	uint64_t t0;
+	uint64_t next = 0; // see 'XORenc_throttle'
+	int      r;
+
+	if (buf == NULL) {
+		return XORENC_ERROR_MEMORY;
+	}
+
+	XORenc_throttle(&next, params->bwlimit, in_len);
+
+	t0      = XORenc_stats_begin(params, XORENC_STAGE_READ);
+	buf_len = XORenc_read_full(in_fd, buf, in_len);
+
+	XORenc_stats_end(params, XORENC_STAGE_READ, t0);
+
+	r = (buf_len < 0) ? XORENC_ERROR_INPUT : XORenc_update(ctx, buf, buf_len);
+
+	if (r >= 0) {
+		// an empty input still generates an empty output
+		next = 0;
+
+		XORenc_throttle(&next, params->bwlimit, buf_len);
+
+		t0 = XORenc_stats_begin(params, XORENC_STAGE_WRITE);
+
+		if (XORenc_write_output(filename, buf, buf_len, 0, std_out, params) < 0) {
+			r = XORENC_ERROR_OUTPUT;
+		}
+		else {
+			XORenc_stats_end(params, XORENC_STAGE_WRITE, t0);
+		}
+	}
+
+	if ((r >= 0) && (params->stats != NULL)) {
+		params->stats->bytes_in  += buf_len;
+		params->stats->bytes_out += buf_len;
+		params->stats->blocks    += (buf_len > 0);
+	}
+
+	free(buf);
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_decompress:
+
+		Path of 'XORenc_encrypt' for input that is a compressed stream (see
+		'XORenc_encrypt_compressed'): it is decrypted and decompressed to '<filename>.xen' (or
+		to standard output).
+
+	Parameters:
+
+		ctx      -> Context at keystream position 0.
+
+		in_fd    -> Descriptor of input file (following 'head').
+
+		head     -> Beginning of input already read (may be NULL if 'head_len' is 0).
+
+		head_len -> Length of 'head' (in bytes).
+
+		filename -> Path to input file.
+
+		std_out  -> Write to standard output (stdout)?
+
+		params   -> The parameters to be considered (output is never split).
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_encrypt_decompress(TXORencContext* ctx, const int in_fd, const uint8_t* head, const size_t head_len, const char* filename, const bool std_out, const TXORencParams* params) {
+
+	char* out_filename;
+	int   out_fd = STDOUT_FILENO;
+	int   r;
+
+	if ((! std_out) && ((filename == NULL) || (params->split_size > 0))) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	if (! std_out) {
+		out_filename = malloc(strlen(filename) + sizeof(".xen"));
+
+		if (out_filename == NULL) {
+			return XORENC_ERROR_MEMORY;
+		}
+
+		sprintf(out_filename, "%s.xen", filename);
+
+		out_fd = open(out_filename, O_WRONLY | O_CREAT | O_EXCL, 0666);
+
+		free(out_filename);
+
+		if (out_fd < 0) {
+			return XORENC_ERROR_OUTPUT;
+		}
+	}
+
+	r = XORenc_compress_stream(ctx, in_fd, out_fd, XORENC_COMPRESS_NONE, head, head_len, *params);
+
+	if (! std_out) {
+		close(out_fd);
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt:
+
+		Perform encryption/decryption of input data from file.
+
+	Parameters:
+
+		filename     -> Path to file to be encrypted. Must be NULL if input is to be read from standard input (stdin).
+
+		key_filename -> Path to key file (or byte sequence) to be used for encryption, must not be NULL if encryption mode is direct.
+        
+		key_str      -> Input key as string, must not be NULL if encryption mode is derived.
+        
+		params       -> The parameters to be applied.
+        
+		std_out      -> Output file to standard output (stdout)?
+        
+	Return value:
+    
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt(const char* filename, const char* key_filename, const char* key_str, const TXORencParams params, const bool std_out) {
+
+	FILE*           fd0;         // input file (or standard input)
+	int             in_fd;       // descriptor of input file
+	struct stat     in_stat;
+	uint8_t         head[16];    // beginning of input, tells if it is a compressed stream
+	ssize_t         head_got;    // length of 'head'
+	size_t          head_len = 0; // bytes of 'head' already consumed from input
+	bool            compressed;
+	bool            small;
+	TXORencContext* ctx;         // streaming context
+	uint8_t*        buf;         // file data buffer
+	size_t          buf_len;     // length of 'buf'
+	size_t          io_size;     // size of read/write requests, see 'XORenc_io_size'
+	uint64_t        done = 0;    // bytes processed so far (position of 'buf' in data)
+	int             r;
+	TXORencStats*   stats = params.stats;
+	uint64_t        t_total, t0;
+	uint64_t        read_next  = 0; // see 'XORenc_throttle'
+	uint64_t        write_next = 0;
+	
+	/* ******* --- XORenc_encrypt --- ******* */
+	
+	t_total = XORenc_clock();
+	
+	r = XORenc_init(&ctx, (params.key_type == Derived) ? key_str : key_filename, params);
+	
+	if (r < 0) {
+		return r;
+	}
+	// *** FREE: ctx
+	
+	
+	// open file ('stat' is done once)
+	in_fd = (filename != NULL) ? open(filename, O_RDONLY) : STDIN_FILENO;
+
+	if ((in_fd < 0) || (fstat(in_fd, &in_stat) != 0)) {
+		if (in_fd >= 0) {
+			close(in_fd);
+		}
+
+		XORenc_final(ctx);
+
+		return XORENC_ERROR_INPUT;
+	}
+
+	// a compressed stream is decrypted and decompressed (beginning of a regular file is only
+	// peeked at, from anything else it is read and kept for the first block)
+	if (S_ISREG(in_stat.st_mode)) {
+		off_t offset = lseek(in_fd, 0, SEEK_CUR);
+
+		head_got = (offset >= 0) ? pread(in_fd, head, sizeof(head), offset) : -1;
+	}
+	else {
+		head_got = XORenc_read_full(in_fd, head, sizeof(head));
+		head_len = (head_got > 0) ? head_got : 0;
+	}
+
+	// a regular file smaller than a block takes the fast path
+	compressed = (head_got > 0) && (XORenc_is_compressed(ctx, head, head_got));
+	small      = (filename != NULL) && (S_ISREG(in_stat.st_mode)) && ((uint64_t)in_stat.st_size < XORENC_FILE_BLOCK_SIZE);
+
+	if ((head_got < 0) || (compressed) || (small)) {
+		if (head_got < 0) {
+			r = XORENC_ERROR_INPUT;
+		}
+		else if (compressed) {
+			r = XORenc_encrypt_decompress(ctx, in_fd, head, head_len, filename, std_out, &params);
+		}
+		else {
+			r = XORenc_encrypt_small(in_fd, in_stat.st_size, ctx, filename, std_out, &params);
+		}
+
+		if (filename != NULL) {
+			close(in_fd);
+		}
+
+		XORenc_final(ctx);
+
+		if ((stats != NULL) || (params.trace != NULL)) {
+			uint64_t t_end = XORenc_clock();
+
+			if (stats != NULL) {
+				stats->total_ns += t_end - t_total;
+			}
+
+			XORenc_trace_event(params.trace, "file", t_total, t_end);
+		}
+
+		return r;
+	}
+
+	if (filename != NULL) {
+		fd0 = fdopen(in_fd, "rb");
+	
+		if (fd0 == NULL) {
+			// could not open file
+			close(in_fd);
+
+			XORenc_final(ctx);
+			
+			return XORENC_ERROR_INPUT;
+		}
+	}
+	else {
+		fd0 = stdin;
+	}
+	// *** FREE: ctx, fd0
+
+
+	// allocate memory for file data buffer (output is written with requests of the same size)
+	io_size = XORenc_io_size(fileno(fd0), &params);
+
+	if (std_out) {
+		size_t out_size = XORenc_io_size(STDOUT_FILENO, &params);
+
+		io_size = (out_size < io_size) ? out_size : io_size;
+	}
+
+	buf = malloc(io_size);
+
+	if (buf == NULL) {
+		r = XORENC_ERROR_MEMORY;
+	}
+	else {
+		memcpy(buf, head, head_len);
+	}
+	// *** FREE: ctx, fd0, buf
+
+
+	// process file in pieces of 'io_size' (an empty input still generates an empty output)
+	if (buf != NULL) do {
+		XORenc_throttle(&read_next, params.bwlimit, io_size);
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = head_len + fread(&buf[head_len], 1, io_size - head_len, fd0);
+		
+		// beginning of input was read already
+		head_len = 0;
+		
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+		
+		if (ferror(fd0)) {
+			r = XORENC_ERROR_INPUT;
+			
+			break;
+		}
+		
+		r = XORenc_update(ctx, buf, buf_len);
+		
+		if (r < 0) {
+			break;
+		}
+		
+		// write encrypted buffer to file; never overwrite an existing file on the first piece
+		if ((buf_len > 0) || (done == 0)) {
+			XORenc_throttle(&write_next, params.bwlimit, buf_len);
+
+			t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+			
+			if (XORenc_write_output(filename, buf, buf_len, done, std_out, &params) < 0) {
+				r = XORENC_ERROR_OUTPUT;
+				
+				break;
+			}
+			
+			XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+		}
+		
+		if (stats != NULL) {
+			stats->bytes_in  += buf_len;
+			stats->bytes_out += buf_len;
+			stats->blocks    += XORenc_blocks(done, buf_len);
+		}
+		
+		// go to next piece
+		done += buf_len;
+	} while (buf_len == io_size);
+
+
+	// free used resources
+	if (filename != NULL) {
+		fclose(fd0);
+	}
+	
+	free(buf);
+	
+	XORenc_final(ctx);
+	
+	if ((stats != NULL) || (params.trace != NULL)) {
+		uint64_t t_end = XORenc_clock();
+
+		if (stats != NULL) {
+			stats->total_ns += t_end - t_total;
+		}
+
+		XORenc_trace_event(params.trace, "file", t_total, t_end);
+	}
+	
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_fd:
+
+		Perform encryption/decryption of data read from a file descriptor, writing the result to
+		another one (e.g. descriptors received from another process).
+
+	Parameters:
+
+		in_fd  -> File descriptor to read input data from (until end of file).
+
+		out_fd -> File descriptor to write output data to.
+
+		key    -> Corresponds to key in one of the three available formats: path to file, byte sequence, or common string.
+
+		params -> The parameters to be applied.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_fd(const int in_fd, const int out_fd, const char* key, const TXORencParams params) {
+
+	TXORencContext* ctx;     // streaming context
+	uint8_t*        buf;     // data buffer
+	ssize_t         buf_len; // length of 'buf'
+	size_t          io_size; // size of read/write requests, see 'XORenc_io_size'
+	uint64_t        position = 0;
+	int             r;
+	TXORencStats*   stats = params.stats;
+	uint64_t        t_total, t0;
+	uint64_t        read_next  = 0; // see 'XORenc_throttle'
+	uint64_t        write_next = 0;
+
+	/* ******* --- XORenc_encrypt_fd --- ******* */
+
+	t_total = XORenc_clock();
+
+	r = XORenc_init(&ctx, key, params);
+
+	if (r < 0) {
+		return r;
+	}
+
+	io_size = XORenc_io_size(in_fd, &params);
+
+	if (XORenc_io_size(out_fd, &params) < io_size) {
+		io_size = XORenc_io_size(out_fd, &params);
+	}
+
+	buf = malloc(io_size);
+
+	if (buf == NULL) {
+		XORenc_final(ctx);
+
+		return XORENC_ERROR_MEMORY;
+	}
+
+
+	do {
+		XORenc_throttle(&read_next, params.bwlimit, io_size);
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = XORenc_read_full(in_fd, buf, io_size);
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if (buf_len < 0) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		r = XORenc_update(ctx, buf, buf_len);
+
+		if (r < 0) {
+			break;
+		}
+
+		XORenc_throttle(&write_next, params.bwlimit, buf_len);
+
+		t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+		if (XORenc_write_full(out_fd, buf, buf_len) < 0) {
+			r = XORENC_ERROR_OUTPUT;
+
+			break;
+		}
+
+		XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+
+		if (stats != NULL) {
+			stats->bytes_in  += buf_len;
+			stats->bytes_out += buf_len;
+			stats->blocks    += XORenc_blocks(position, buf_len);
+		}
+
+		position += buf_len;
+	} while ((size_t)buf_len == io_size);
+
+
+	free(buf);
+
+	XORenc_final(ctx);
+
+	if ((stats != NULL) || (params.trace != NULL)) {
+		uint64_t t_end = XORenc_clock();
+
+		if (stats != NULL) {
+			stats->total_ns += t_end - t_total;
+		}
+
+		XORenc_trace_event(params.trace, "file", t_total, t_end);
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_span:
+
+		En/de-crypt 'length' bytes of input file from 'in_offset' (0 means up to its end) with
+		keystream from 'key_offset', see 'XORenc_encrypt_range' and 'XORenc_encrypt_pad'.
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_encrypt_span(const int in_fd, const int out_fd, const char* key, const uint64_t in_offset, const uint64_t key_offset, const uint64_t length, const TXORencParams params) {
+
+	TXORencContext* ctx;     // streaming context
+	uint8_t*        buf;     // data buffer
+	ssize_t         buf_len; // length of 'buf'
+	size_t          io_size; // size of read/write requests, see 'XORenc_io_size'
+	uint64_t        position   = in_offset;
+	uint64_t        end        = (length > 0) ? (in_offset + length) : UINT64_MAX;
+	int             r;
+	TXORencStats*   stats      = params.stats;
+	uint64_t        t_total, t0;
+	uint64_t        read_next  = 0; // see 'XORenc_throttle'
+	uint64_t        write_next = 0;
+
+	/* ******* --- XORenc_encrypt_span --- ******* */
+
+	if ((length > 0) && (end < in_offset)) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	t_total = XORenc_clock();
+
+	r = XORenc_init(&ctx, key, params);
+
+	if (r < 0) {
+		return r;
+	}
+
+	io_size = XORenc_io_size(in_fd, &params);
+
+	if (XORenc_io_size(out_fd, &params) < io_size) {
+		io_size = XORenc_io_size(out_fd, &params);
+	}
+
+	buf = malloc(io_size);
+
+	if (buf == NULL) {
+		XORenc_final(ctx);
+
+		return XORENC_ERROR_MEMORY;
+	}
+
+	r = XORenc_seek(ctx, key_offset);
+
+
+	while ((r >= 0) && (position < end)) {
+		size_t want = ((end - position) < io_size) ? (end - position) : io_size;
+
+		XORenc_throttle(&read_next, params.bwlimit, want);
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = pread(in_fd, buf, want, position);
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if ((buf_len < 0) && (errno == EINTR)) {
+			continue;
+		}
+
+		if (buf_len < 0) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		if (buf_len == 0) {
+			// end of input
+			break;
+		}
+
+		r = XORenc_update(ctx, buf, buf_len);
+
+		if (r < 0) {
+			break;
+		}
+
+		XORenc_throttle(&write_next, params.bwlimit, buf_len);
+
+		t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+		if (XORenc_write_full(out_fd, buf, buf_len) < 0) {
+			r = XORENC_ERROR_OUTPUT;
+
+			break;
+		}
+
+		XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+
+		position += buf_len;
+
+		if (stats != NULL) {
+			stats->bytes_in  += buf_len;
+			stats->bytes_out += buf_len;
+			stats->blocks    += XORenc_blocks(position - in_offset - buf_len, buf_len);
+		}
+	}
+
+
+	free(buf);
+
+	XORenc_final(ctx);
+
+	if ((stats != NULL) || (params.trace != NULL)) {
+		uint64_t t_end = XORenc_clock();
+
+		if (stats != NULL) {
+			stats->total_ns += t_end - t_total;
+		}
+
+		XORenc_trace_event(params.trace, "file", t_total, t_end);
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_range:
+
+		En/de-crypt only a byte range of input file. Keystream is addressed by position, so
+		nothing before the range is read (direct keys are mapped, only the matching part
+		of key file is read; derived keys still have to regenerate their chain up to it).
+
+	Parameters:
+
+		in_fd    -> File descriptor of input data, must be seekable (read with 'pread').
+
+		out_fd   -> File descriptor to write en/de-crypted range to.
+
+		key      -> Path to key file, byte sequence or password, according to 'params.key_type'.
+
+		offset   -> Position of first byte of the range.
+
+		length   -> Length of the range, 0 means up to the end of input. A range past the end of
+					input is cut to it.
+
+		params   -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_range(const int in_fd, const int out_fd, const char* key, const uint64_t offset, const uint64_t length, const TXORencParams params) {
+
+	return XORenc_encrypt_span(in_fd, out_fd, key, offset, offset, length, params);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_part:
+
+		En/de-crypt a whole part of output split by 'params.split_size' on its own; its data
+		is XOR'ed with keystream from 'position' (part N starts at 'N * split_size').
+
+	Parameters:
+
+		in_fd    -> File descriptor of part, must be seekable (read with 'pread').
+
+		out_fd   -> File descriptor to write en/de-crypted part to.
+
+		key      -> Path to key file, byte sequence or password, according to 'params.key_type'.
+
+		position -> Keystream position of first byte of part.
+
+		params   -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_part(const int in_fd, const int out_fd, const char* key, const uint64_t position, const TXORencParams params) {
+
+	return XORenc_encrypt_span(in_fd, out_fd, key, 0, position, 0, params);
+}
+
+/** ----------------------------------------------------------------
+
+	One-time-pad pool.
+
+	A large pad (direct key file) is shared by many files, each one
+	en/de-crypted with its own slice that is never given out again.
+	Slices are handed out by an allocation log ('<pad>.alloc', one
+	'TXORencPadRecord' per slice, in order) locked with 'flock', so
+	concurrent processes and threads never get overlapping slices.
+
+	Encrypted file starts with a 'TXORencPadRecord' header (magic
+	"XENPAD01", offset and length of its slice, little endian),
+	followed by the en/de-crypted data.
+
+	---------------------------------------------------------------- */
+typedef struct {
+	char     magic[8]; // "XENPAD01"
+	uint64_t offset;   // offset of slice in pad
+	uint64_t length;   // length of slice (and of the data)
+} TXORencPadRecord;
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_pad_allocate:
+
+		Allocate a slice of pad that was never given out before.
+
+	Parameters:
+
+		pad    -> Path to pad (key file).
+
+		length -> Length of slice.
+
+		offset -> Where to store offset of slice in pad.
+
+	Return value:
+
+		Returns positive value or 0 if successful, 'XORENC_ERROR_KEY_TOO_SHORT' if pad is used up.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_pad_allocate(const char* pad, const uint64_t length, uint64_t* offset) {
+
+	TXORencPadRecord record;
+	struct stat      pad_stat, log_stat;
+	char*            log_name = (pad != NULL) ? malloc(strlen(pad) + sizeof(".alloc")) : NULL;
+	off_t            log_end;
+	int              fd0;
+	int              r        = XORENC_OK;
+
+	if ((pad == NULL) || (offset == NULL) || (log_name == NULL)) {
+		free(log_name);
+
+		return ((pad != NULL) && (log_name == NULL)) ? XORENC_ERROR_MEMORY : XORENC_ERROR_PARAMS;
+	}
+
+	if (stat(pad, &pad_stat) != 0) {
+		free(log_name);
+
+		return XORENC_ERROR_KEY;
+	}
+
+	sprintf(log_name, "%s.alloc", pad);
+
+	fd0 = open(log_name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+	free(log_name);
+
+	if (fd0 < 0) {
+		return XORENC_ERROR_OUTPUT;
+	}
+
+	// lock is released by closing the log
+	while ((flock(fd0, LOCK_EX) != 0) && (errno == EINTR));
+
+	// a torn last record (its slice was never handed out) is overwritten
+	if (fstat(fd0, &log_stat) != 0) {
+		r = XORENC_ERROR_INPUT;
+	}
+
+	log_end = (r >= 0) ? (log_stat.st_size / sizeof(record)) * sizeof(record) : 0;
+	*offset = 0;
+
+	if ((r >= 0) && (log_end > 0)) {
+		if (pread(fd0, &record, sizeof(record), log_end - sizeof(record)) != sizeof(record)) {
+			r = XORENC_ERROR_INPUT;
+		}
+
+		*offset = le64toh(record.offset) + le64toh(record.length);
+	}
+
+	if ((r >= 0) && ((*offset > (uint64_t)pad_stat.st_size) || (length > (uint64_t)pad_stat.st_size - *offset))) {
+		r = XORENC_ERROR_KEY_TOO_SHORT;
+	}
+
+	if (r >= 0) {
+		memcpy(record.magic, "XENPAD01", 8);
+
+		record.offset = htole64(*offset);
+		record.length = htole64(length);
+
+		// slice may only be used once it is durably given out
+		if ((pwrite(fd0, &record, sizeof(record), log_end) != sizeof(record)) || (fdatasync(fd0) != 0)) {
+			r = XORENC_ERROR_OUTPUT;
+		}
+	}
+
+	close(fd0);
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_pad:
+
+		En/de-crypt file with a slice of one-time-pad pool. Input starting with a pad header is
+		decrypted with the slice it names (header is removed), any other input is encrypted
+		with a newly allocated slice (header is written first).
+
+	Parameters:
+
+		in_fd  -> File descriptor of input data, must be a regular file.
+
+		out_fd -> File descriptor to write output to.
+
+		pad    -> Path to pad (key file).
+
+		params -> The parameters to be considered ('key_type' must be 'Direct').
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_pad(const int in_fd, const int out_fd, const char* pad, const TXORencParams params) {
+
+	TXORencPadRecord header;
+	struct stat      in_stat;
+	uint64_t         offset;
+	int              r;
+
+	if ((params.key_type != Direct) || (params.cyclic_key) || (params.extra_key_count > 0)) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	if ((fstat(in_fd, &in_stat) != 0) || (! S_ISREG(in_stat.st_mode))) {
+		return XORENC_ERROR_INPUT;
+	}
+
+	if ((in_stat.st_size >= (off_t)sizeof(header)) && (pread(in_fd, &header, sizeof(header), 0) == sizeof(header)) && (memcmp(header.magic, "XENPAD01", 8) == 0)) {
+		// decrypt with the slice named by header
+		if (le64toh(header.length) != (uint64_t)in_stat.st_size - sizeof(header)) {
+			return XORENC_ERROR_INPUT;
+		}
+
+		if (le64toh(header.length) == 0) {
+			return XORENC_OK;
+		}
+
+		return XORenc_encrypt_span(in_fd, out_fd, pad, sizeof(header), le64toh(header.offset), le64toh(header.length), params);
+	}
+
+
+	// encrypt with a new slice
+	r = XORenc_pad_allocate(pad, in_stat.st_size, &offset);
+
+	if (r < 0) {
+		return r;
+	}
+
+	memcpy(header.magic, "XENPAD01", 8);
+
+	header.offset = htole64(offset);
+	header.length = htole64(in_stat.st_size);
+
+	if (XORenc_write_full(out_fd, (const uint8_t*)&header, sizeof(header)) < 0) {
+		return XORENC_ERROR_OUTPUT;
+	}
+
+	if (in_stat.st_size == 0) {
+		return XORENC_OK;
+	}
+
+	return XORenc_encrypt_span(in_fd, out_fd, pad, 0, offset, in_stat.st_size, params);
+}
+
+/** ----------------------------------------------------------------
+
+	Checksum trailer, see 'XORenc_encrypt_checked'.
+
+	Encrypted data is followed by the CRC32C of the plaintext of
+	every block ('XORENC_FILE_BLOCK_SIZE'), then by a footer:
+
+		"XENCRC01"   (8 bytes)
+		data length  (8 bytes)
+		CRC32C       (4 bytes, of block CRCs, magic and data length)
+		reserved     (4 bytes, 0)
+
+	All numbers are little endian. The footer is at the end of the
+	file, so it can be found without reading the data.
+
+	---------------------------------------------------------------- */
+typedef struct {
+	char     magic[8]; // "XENCRC01"
+	uint64_t length;   // length of data
+	uint32_t crc;      // CRC32C of block CRCs, 'magic' and 'length'
+	uint32_t reserved;
+} TXORencCRCFooter;
+
+#define XORENC_CRC_PIECE 4096 // data is checksummed and XOR'ed in pieces this small, while they are in L1 cache
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_update_crc:
+
+		'XORenc_update' that also calculates CRC32C of the plaintext in the same pass (before
+		XOR when encrypting, after XOR when decrypting).
+
+	---------------------------------------------------------------------------------------- */
+static int XORenc_update_crc(TXORencContext* ctx, uint8_t* data, const size_t data_len, const bool encrypting, uint32_t* crc) {
+
+	size_t piece_len;
+	size_t lpp0;
+	int    r;
+
+	for (lpp0=0; lpp0 < data_len; lpp0 += piece_len) {
+		piece_len = ((data_len - lpp0) < XORENC_CRC_PIECE) ? (data_len - lpp0) : XORENC_CRC_PIECE;
+
+		if (encrypting) {
+			*crc = XORenc_crc32c(*crc, &data[lpp0], piece_len);
+		}
+
+		r = XORenc_update(ctx, &data[lpp0], piece_len);
+
+		if (r < 0) {
+			return r;
+		}
+
+		if (! encrypting) {
+			*crc = XORenc_crc32c(*crc, &data[lpp0], piece_len);
+		}
+	}
+
+	return XORENC_OK;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_footer_crc:
+
+		Calculate CRC32C of block CRCs and footer of checksum trailer.
+
+	---------------------------------------------------------------------------------------- */
+static uint32_t XORenc_footer_crc(const uint32_t* crcs, const uint64_t count, const TXORencCRCFooter* footer) {
+
+	uint32_t crc = XORenc_crc32c(0, (const uint8_t*)crcs, count * sizeof(uint32_t));
+
+	crc = XORenc_crc32c(crc, (const uint8_t*)footer->magic, sizeof(footer->magic));
+
+	return XORenc_crc32c(crc, (const uint8_t*)&footer->length, sizeof(footer->length));
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_is_checked:
+
+		Is input a regular file ending with a checksum trailer (see 'XORenc_encrypt_checked')?
+
+	---------------------------------------------------------------------------------------- */
+bool XORenc_is_checked(const int in_fd) {
+
+	TXORencCRCFooter footer;
+	struct stat      in_stat;
+
+	return ((fstat(in_fd, &in_stat) == 0) && (S_ISREG(in_stat.st_mode)) && (in_stat.st_size >= (off_t)sizeof(footer)) &&
+			(pread(in_fd, &footer, sizeof(footer), in_stat.st_size - sizeof(footer)) == sizeof(footer)) && (memcmp(footer.magic, "XENCRC01", 8) == 0));
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_checked:
+
+		En/de-crypt with a checksum trailer, CRC32C of the plaintext of every block is
+		calculated in the same pass as XOR.
+
+		When encrypting ('seal'), input is read as a stream and the trailer is written after
+		the data. When decrypting, input must be a regular file ending with a trailer; every
+		block is checked before it is written, so corrupted data (or data decrypted with a
+		wrong key) is never written past the first bad block.
+
+	Parameters:
+
+		in_fd  -> File descriptor of input data.
+
+		out_fd -> File descriptor to write output to, or -1 to only verify (decrypting).
+
+		key    -> Path to key file, byte sequence or password, according to 'params.key_type'.
+
+		seal   -> Encrypt and write trailer? Otherwise decrypt and check it.
+
+		params -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful, 'XORENC_ERROR_CHECKSUM' if a checksum
+		does not match.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_checked(const int in_fd, const int out_fd, const char* key, const bool seal, const TXORencParams params) {
+
+	TXORencContext*  ctx;
+	TXORencCRCFooter footer;
+	TXORencStats*    stats      = params.stats;
+	struct stat      in_stat;
+	uint8_t*         buf        = malloc(XORENC_FILE_BLOCK_SIZE);
+	uint32_t*        crcs       = NULL;
+	uint64_t         count      = 0; // number of blocks
+	uint64_t         capacity   = 0; // size of 'crcs' (in items)
+	uint64_t         position   = 0;
+	uint64_t         t_total    = XORenc_clock();
+	uint64_t         t0;
+	uint64_t         read_next  = 0; // see 'XORenc_throttle'
+	uint64_t         write_next = 0;
+	ssize_t          buf_len;
+	uint64_t         lpp0;
+	int              r;
+
+	/* ******* --- XORenc_encrypt_checked --- ******* */
+
+	if (buf == NULL) {
+		return XORENC_ERROR_MEMORY;
+	}
+
+	r = XORenc_init(&ctx, key, params);
+	// *** FREE: ctx, buf, crcs
+
+
+	// decrypting, load trailer first
+	if ((r >= 0) && (! seal)) {
+		if ((fstat(in_fd, &in_stat) != 0) || (! S_ISREG(in_stat.st_mode)) || (in_stat.st_size < (off_t)sizeof(footer)) ||
+			(pread(in_fd, &footer, sizeof(footer), in_stat.st_size - sizeof(footer)) != sizeof(footer)) || (memcmp(footer.magic, "XENCRC01", 8) != 0)) {
+			r = XORENC_ERROR_INPUT;
+		}
+
+		if (r >= 0) {
+			count = (le64toh(footer.length) + XORENC_FILE_BLOCK_SIZE - 1) / XORENC_FILE_BLOCK_SIZE;
+
+			if ((le64toh(footer.length) > (uint64_t)in_stat.st_size) || (le64toh(footer.length) + (count * sizeof(uint32_t)) + sizeof(footer) != (uint64_t)in_stat.st_size)) {
+				r = XORENC_ERROR_INPUT;
+			}
+		}
+
+		if (r >= 0) {
+			crcs = malloc((count > 0) ? count * sizeof(uint32_t) : 1);
+			r    = (crcs == NULL) ? XORENC_ERROR_MEMORY : r;
+		}
+
+		if ((r >= 0) && (pread(in_fd, crcs, count * sizeof(uint32_t), le64toh(footer.length)) != (ssize_t)(count * sizeof(uint32_t)))) {
+			r = XORENC_ERROR_INPUT;
+		}
+
+		if ((r >= 0) && (XORenc_footer_crc(crcs, count, &footer) != le32toh(footer.crc))) {
+			// trailer itself is corrupted
+			r = XORENC_ERROR_CHECKSUM;
+		}
+	}
+
+
+	for (lpp0=0; r >= 0; lpp0++) {
+		uint32_t crc = 0;
+		size_t   want = XORENC_FILE_BLOCK_SIZE;
+
+		if (! seal) {
+			if (lpp0 == count) {
+				break;
+			}
+
+			want = ((le64toh(footer.length) - position) < XORENC_FILE_BLOCK_SIZE) ? (le64toh(footer.length) - position) : XORENC_FILE_BLOCK_SIZE;
+		}
+
+		XORenc_throttle(&read_next, params.bwlimit, want);
+
+		t0      = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		buf_len = (seal) ? XORenc_read_full(in_fd, buf, want) : pread(in_fd, buf, want, position);
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if ((buf_len < 0) || ((! seal) && ((size_t)buf_len != want))) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		if (buf_len == 0) {
+			// end of input (sealing)
+			break;
+		}
+
+		r = XORenc_update_crc(ctx, buf, buf_len, seal, &crc);
+
+		if (r < 0) {
+			break;
+		}
+
+		if (seal) {
+			// keep CRC of block for trailer
+			if (count == capacity) {
+				uint32_t* grown = realloc(crcs, ((capacity > 0) ? capacity * 2 : 1024) * sizeof(uint32_t));
+
+				if (grown == NULL) {
+					r = XORENC_ERROR_MEMORY;
+
+					break;
+				}
+
+				crcs     = grown;
+				capacity = (capacity > 0) ? capacity * 2 : 1024;
+			}
+
+			crcs[count++] = htole32(crc);
+		}
+		else if (crc != le32toh(crcs[lpp0])) {
+			// checked before it is written
+			r = XORENC_ERROR_CHECKSUM;
+
+			break;
+		}
+
+		if (out_fd >= 0) {
+			XORenc_throttle(&write_next, params.bwlimit, buf_len);
+
+			t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+			if (XORenc_write_full(out_fd, buf, buf_len) < 0) {
+				r = XORENC_ERROR_OUTPUT;
+
+				break;
+			}
+
+			XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+		}
+
+		position += buf_len;
+
+		if (stats != NULL) {
+			stats->bytes_in  += buf_len;
+			stats->bytes_out += (out_fd >= 0) ? buf_len : 0;
+			stats->blocks    += XORenc_blocks(position - buf_len, buf_len);
+		}
+
+		if ((seal) && ((size_t)buf_len < want)) {
+			break;
+		}
+	}
+
+
+	// encrypting, write trailer after data
+	if ((r >= 0) && (seal)) {
+		memcpy(footer.magic, "XENCRC01", 8);
+
+		footer.length   = htole64(position);
+		footer.reserved = 0;
+		footer.crc      = htole32(XORenc_footer_crc(crcs, count, &footer));
+
+		if (((count > 0) && (XORenc_write_full(out_fd, (const uint8_t*)crcs, count * sizeof(uint32_t)) < 0)) || (XORenc_write_full(out_fd, (const uint8_t*)&footer, sizeof(footer)) < 0)) {
+			r = XORENC_ERROR_OUTPUT;
+		}
+	}
+
+
+	// free used resources
+	if (ctx != NULL) {
+		XORenc_final(ctx);
+	}
+
+	free(buf);
+	free(crcs);
+
+	if ((stats != NULL) || (params.trace != NULL)) {
+		uint64_t t_end = XORenc_clock();
+
+		if (stats != NULL) {
+			stats->total_ns += t_end - t_total;
+		}
+
+		XORenc_trace_event(params.trace, "file", t_total, t_end);
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_follow:
+
+		En/de-crypt a file that is still growing (e.g. a log being written), like 'tail -f':
+		data is read as it is appended and written out at the latest 'latency_ms' after it
+		arrived (or as soon as a block is full). The keystream simply continues, so the
+		output is the same as of the whole file processed at once (the chain of derived
+		blocks is kept by the context between pieces).
+
+		The file is watched with inotify, nothing is done while no data arrives. Following
+		ends when the file is removed (its last link, seen as a change of attributes since
+		it is still open) or renamed (e.g. log rotation) or when 'stop_fd' becomes readable;
+		data left is processed first.
+
+	Parameters:
+
+		filename   -> Path to input file.
+
+		out_fd     -> File descriptor to write output to.
+
+		key        -> Path to key file, byte sequence or password, according to 'params.key_type'.
+
+		latency_ms -> Longest time data waits before it is written (in milliseconds, at most
+		              'INT_MAX'; 0 writes it as soon as it is read).
+
+		stop_fd    -> File descriptor that ends following when readable (e.g. a 'signalfd'),
+		              or -1.
+
+		params     -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful, 'XORENC_ERROR_INPUT' also if the file was
+		truncated while followed.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_follow(const char* filename, const int out_fd, const char* key, const uint64_t latency_ms, const int stop_fd, const TXORencParams params) {
+
+	TXORencContext* ctx;
+	TXORencStats*   stats      = params.stats;
+	struct pollfd   watch[2];
+	struct stat     in_stat;
+	uint8_t*        buf        = malloc(XORENC_FILE_BLOCK_SIZE);
+	uint8_t         events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	size_t          pending    = 0; // bytes read but not written yet
+	uint64_t        position   = 0; // bytes read
+	uint64_t        deadline   = 0; // when pending data must be written (see 'XORenc_clock')
+	uint64_t        t_total    = XORenc_clock();
+	uint64_t        t0;
+	bool            modified   = false;
+	bool            finishing  = false;
+	int             in_fd      = -1;
+	int             watch_fd   = -1;
+	int             r;
+
+	/* ******* --- XORenc_encrypt_follow --- ******* */
+
+	if ((buf == NULL) || (latency_ms > INT_MAX)) {
+		free(buf);
+
+		return (buf == NULL) ? XORENC_ERROR_MEMORY : XORENC_ERROR_PARAMS;
+	}
+
+	r = XORenc_init(&ctx, key, params);
+	// *** FREE: ctx, buf, in_fd, watch_fd
+
+
+	// watch before first read, so nothing appended in between is missed
+	if (r >= 0) {
+		watch_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		in_fd    = open(filename, O_RDONLY);
+
+		if ((watch_fd < 0) || (in_fd < 0) || (inotify_add_watch(watch_fd, filename, IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF) < 0)) {
+			r = XORENC_ERROR_INPUT;
+		}
+	}
+
+
+	while (r >= 0) {
+		ssize_t got;
+		int     timeout = -1;
+		int     ready;
+
+		t0  = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+		got = read(in_fd, &buf[pending], XORENC_FILE_BLOCK_SIZE - pending);
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		if ((got < 0) && (errno == EINTR)) {
+			continue;
+		}
+
+		if (got < 0) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		if (got > 0) {
+			if (pending == 0) {
+				deadline = XORenc_clock() + (latency_ms * 1000000);
+			}
+
+			pending  += got;
+			position += got;
+		}
+		else if ((modified) && (fstat(in_fd, &in_stat) == 0) && ((uint64_t)in_stat.st_size < position)) {
+			// truncated (e.g. 'copytruncate' rotation), appended data can not be told apart
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		modified = false;
+
+		// write pending data once a block is full, its latency is reached, or at the end
+		if ((pending == XORENC_FILE_BLOCK_SIZE) || ((pending > 0) && (got == 0) && ((finishing) || (XORenc_clock() >= deadline)))) {
+			r = XORenc_update(ctx, buf, pending);
+
+			if (r < 0) {
+				break;
+			}
+
+			t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+			if (XORenc_write_full(out_fd, buf, pending) < 0) {
+				r = XORENC_ERROR_OUTPUT;
+
+				break;
+			}
+
+			XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+
+			if (stats != NULL) {
+				stats->bytes_in  += pending;
+				stats->bytes_out += pending;
+				stats->blocks    += XORenc_blocks(position - pending, pending);
+			}
+
+			pending = 0;
+		}
+
+		if (got > 0) {
+			// there may be more
+			continue;
+		}
+
+		if (finishing) {
+			break;
+		}
+
+
+		// wait for data (or until pending data is due)
+		if (pending > 0) {
+			uint64_t now = XORenc_clock();
+
+			timeout = (deadline > now) ? (int)(((deadline - now) + 999999) / 1000000) : 0;
+		}
+
+		watch[0].fd     = watch_fd;
+		watch[0].events = POLLIN;
+		watch[1].fd     = stop_fd;
+		watch[1].events = POLLIN;
+
+		ready = poll(watch, (stop_fd >= 0) ? 2 : 1, timeout);
+
+		if ((ready < 0) && (errno != EINTR)) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		if ((ready > 0) && (stop_fd >= 0) && (watch[1].revents != 0)) {
+			finishing = true;
+		}
+
+		if ((ready > 0) && (watch[0].revents != 0)) {
+			ssize_t length = read(watch_fd, events, sizeof(events));
+			ssize_t lpp0;
+
+			for (lpp0=0; lpp0 < length; lpp0 += sizeof(struct inotify_event) + ((struct inotify_event*)&events[lpp0])->len) {
+				const struct inotify_event* event = (const struct inotify_event*)&events[lpp0];
+
+				modified  = modified || ((event->mask & IN_MODIFY) != 0);
+				finishing = finishing || ((event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) != 0);
+
+				// 'IN_DELETE_SELF' only comes once the file is closed, removal shows up as its link count
+				if (((event->mask & IN_ATTRIB) != 0) && (fstat(in_fd, &in_stat) == 0) && (in_stat.st_nlink == 0)) {
+					finishing = true;
+				}
+			}
+		}
+	}
+
+
+	// free used resources
+	if (in_fd >= 0) {
+		close(in_fd);
+	}
+
+	if (watch_fd >= 0) {
+		close(watch_fd);
+	}
+
+	if (ctx != NULL) {
+		XORenc_final(ctx);
+	}
+
+	free(buf);
+
+	if ((stats != NULL) || (params.trace != NULL)) {
+		uint64_t t_end = XORenc_clock();
+
+		if (stats != NULL) {
+			stats->total_ns += t_end - t_total;
+		}
+
+		XORenc_trace_event(params.trace, "file", t_total, t_end);
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------
+
+	Key generation, see 'XORenc_generate_key'.
+
+	Key file is split in chunks, each one generated and written by
+	the first free thread; ChaCha20 blocks are addressed by counter,
+	so chunks can be made in any order.
+
+	---------------------------------------------------------------- */
+#define XORENC_KEYGEN_CHUNK (4 * 1024 * 1024) // bytes generated and written at once (multiple of 64)
+
+typedef struct {
+	pthread_mutex_t lock;
+	uint8_t         seed[32]; // ChaCha20 key, from 'getrandom'
+	uint64_t        nonce;    // ChaCha20 nonce, from 'getrandom'
+	int             fd;       // key file
+	uint64_t        size;     // size of key file
+	uint64_t        next;     // offset of next chunk to generate
+	int             result;   // first error of any thread
+	TXORencStats*   stats;
+} TXORencKeygen;
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_generate_key_thread:
+
+		Generate and write chunks of key file until none are left.
+
+	---------------------------------------------------------------------------------------- */
+static void* XORenc_generate_key_thread(void* arg) {
+
+	TXORencKeygen* keygen   = arg;
+	uint8_t*       buf      = malloc(XORENC_KEYGEN_CHUNK);
+	uint64_t       previous = UINT64_MAX; // chunk written before, its pages are dropped once on disk
+	uint64_t       chunk;
+	size_t         length, done;
+	int            r        = (buf == NULL) ? XORENC_ERROR_MEMORY : XORENC_OK;
+
+	while (r >= 0) {
+		pthread_mutex_lock(&keygen->lock);
+
+		chunk         = keygen->next;
+		keygen->next += XORENC_KEYGEN_CHUNK;
+
+		if (keygen->result < 0) {
+			chunk = keygen->size;
+		}
+
+		pthread_mutex_unlock(&keygen->lock);
+
+		if (chunk >= keygen->size) {
+			break;
+		}
+
+		length = ((keygen->size - chunk) < XORENC_KEYGEN_CHUNK) ? (keygen->size - chunk) : XORENC_KEYGEN_CHUNK;
+
+		XORenc_chacha20(keygen->seed, keygen->nonce, chunk / 64, buf, length);
+
+		for (done=0; done < length; ) {
+			ssize_t written = pwrite(keygen->fd, &buf[done], length - done, chunk + done);
+
+			if ((written < 0) && (errno == EINTR)) {
+				continue;
+			}
+
+			if (written <= 0) {
+				r = XORENC_ERROR_OUTPUT;
+
+				break;
+			}
+
+			done += written;
+		}
+
+		// start writeback now and keep page cache clean, key goes straight to disk
+		sync_file_range(keygen->fd, chunk, length, SYNC_FILE_RANGE_WRITE);
+
+		if (previous != UINT64_MAX) {
+			sync_file_range(keygen->fd, previous, XORENC_KEYGEN_CHUNK, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+			posix_fadvise(keygen->fd, previous, XORENC_KEYGEN_CHUNK, POSIX_FADV_DONTNEED);
+		}
+
+		previous = chunk;
+
+		pthread_mutex_lock(&keygen->lock);
+
+		if (keygen->stats != NULL) {
+			keygen->stats->bytes_out += done;
+			keygen->stats->blocks    += 1;
+		}
+
+		pthread_mutex_unlock(&keygen->lock);
+	}
+
+	pthread_mutex_lock(&keygen->lock);
+
+	keygen->result = ((r < 0) && (keygen->result >= 0)) ? r : keygen->result;
+
+	pthread_mutex_unlock(&keygen->lock);
+
+	if (buf != NULL) {
+		explicit_bzero(buf, XORENC_KEYGEN_CHUNK);
+		free(buf);
+	}
+
+	return NULL;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_generate_key:
+
+		Generate a random key file (for direct mode), seeded by 'getrandom' and expanded with
+		ChaCha20 by several threads. Key file is preallocated and must not exist.
+
+	Parameters:
+
+		filename -> Path to key file to create.
+
+		size     -> Size of key (in bytes).
+
+		threads  -> Number of threads to use (0 uses all CPUs).
+
+		params   -> The parameters to be considered (only 'stats').
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_generate_key(const char* filename, const uint64_t size, unsigned int threads, const TXORencParams params) {
+
+	TXORencKeygen keygen;
+	uint8_t       material[sizeof(keygen.seed) + sizeof(keygen.nonce)];
+	pthread_t*    workers;
+	uint64_t      t_total = XORenc_clock();
+	size_t        seeded  = 0;
+	unsigned int  started = 0;
+	unsigned int  lpp0;
+	int           r;
+
+	/* ******* --- XORenc_generate_key --- ******* */
+
+	if ((filename == NULL) || (size == 0)) {
+		return XORENC_ERROR_PARAMS;
+	}
+
+	memset(&keygen, 0, sizeof(keygen));
+
+	// seed (key and nonce of ChaCha20)
+	while (seeded < sizeof(material)) {
+		ssize_t got = getrandom(&material[seeded], sizeof(material) - seeded, 0);
+
+		if ((got < 0) && (errno == EINTR)) {
+			continue;
+		}
+
+		if (got <= 0) {
+			explicit_bzero(material, sizeof(material));
+
+			return XORENC_ERROR_KEY;
+		}
+
+		seeded += got;
+	}
+
+	memcpy(keygen.seed, material, sizeof(keygen.seed));
+	memcpy(&keygen.nonce, &material[sizeof(keygen.seed)], sizeof(keygen.nonce));
+	explicit_bzero(material, sizeof(material));
+
+	keygen.fd = open(filename, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+	if (keygen.fd < 0) {
+		explicit_bzero(keygen.seed, sizeof(keygen.seed));
+
+		return XORENC_ERROR_OUTPUT;
+	}
+
+	// preallocate, so key file is not fragmented and running out of space shows up now
+	r = posix_fallocate(keygen.fd, 0, size);
+
+	if (r == ENOSPC) {
+		keygen.result = XORENC_ERROR_OUTPUT;
+	}
+
+	keygen.size  = size;
+	keygen.stats = params.stats;
+
+	pthread_mutex_init(&keygen.lock, NULL);
+
+
+	if (threads == 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+
+	if ((uint64_t)threads > (size + XORENC_KEYGEN_CHUNK - 1) / XORENC_KEYGEN_CHUNK) {
+		threads = (size + XORENC_KEYGEN_CHUNK - 1) / XORENC_KEYGEN_CHUNK;
+	}
+
+	workers = calloc((threads > 0) ? threads : 1, sizeof(pthread_t));
+
+	if (workers == NULL) {
+		keygen.result = XORENC_ERROR_MEMORY;
+	}
+
+	for (lpp0=0; (keygen.result >= 0) && (lpp0 < threads); lpp0++) {
+		if (pthread_create(&workers[lpp0], NULL, XORenc_generate_key_thread, &keygen) != 0) {
+			break;
+		}
+
+		started += 1;
+	}
+
+	if ((started == 0) && (keygen.result >= 0)) {
+		// no thread could be started, generate here
+		XORenc_generate_key_thread(&keygen);
+	}
+
+	for (lpp0=0; lpp0 < started; lpp0++) {
+		pthread_join(workers[lpp0], NULL);
+	}
+
+	free(workers);
+
+	pthread_mutex_destroy(&keygen.lock);
+
+	explicit_bzero(keygen.seed, sizeof(keygen.seed));
+
+
+	if ((fdatasync(keygen.fd) != 0) && (keygen.result >= 0)) {
+		keygen.result = XORENC_ERROR_OUTPUT;
+	}
+
+	if ((close(keygen.fd) != 0) && (keygen.result >= 0)) {
+		keygen.result = XORENC_ERROR_OUTPUT;
+	}
+
+	if (keygen.result < 0) {
+		// never leave a partial key behind
+		unlink(filename);
+	}
+
+	if (params.stats != NULL) {
+		params.stats->total_ns += XORenc_clock() - t_total;
+	}
+
+	return keygen.result;
+}
+
+/** ----------------------------------------------------------------
+
+	Journal of in-place encryption ('<file>.xenj').
+
+	Before a block is overwritten, a record describing it is made
+	durable: its position and a short hash of every sector of its
+	original data. A crash can then leave each sector of that block
+	either original or en/de-crypted (sectors are written atomically)
+	and recovery tells them apart by hash, restores the original
+	block and continues from it. Records alternate between two slots,
+	so a torn record never destroys the previous one; the valid
+	record with the highest sequence number is the current one.
+
+	Journal is about 1/64 of the data (instead of a copy of it), so
+	in-place encryption writes the data only once.
+
+	---------------------------------------------------------------- */
+#define XORENC_JOURNAL_SECTOR 512 // smallest unit written atomically by storage
+
+typedef struct {
+	char     magic[8];     // "XENJRNL1"
+	uint64_t sequence;     // number of record
+	uint64_t position;     // offset of block being rewritten
+	uint64_t length;       // length of block
+	uint64_t file_size;    // size of file the journal belongs to
+	uint8_t  key_check[8]; // md5 of keystream of block (truncated), recovery must use the same key
+	uint8_t  checksum[16]; // md5 of record (this field zeroed) and sector hashes
+} TXORencJournal;
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_journal_hash:
+
+		Hash every sector of block (md5, truncated to 8 bytes) into 'hashes'.
+
+	---------------------------------------------------------------------------------------- */
+static void XORenc_journal_hash(const uint8_t* block, const size_t length, uint8_t* hashes) {
+
+	uint8_t digest_b[16];
+	char    digest_s[32];
+	size_t  lpp0;
+
+	for (lpp0=0; lpp0 < length; lpp0 += XORENC_JOURNAL_SECTOR) {
+		XORenc_md5(&block[lpp0], ((length - lpp0) < XORENC_JOURNAL_SECTOR) ? (length - lpp0) : XORENC_JOURNAL_SECTOR, digest_b, digest_s);
+
+		memcpy(&hashes[(lpp0 / XORENC_JOURNAL_SECTOR) * 8], digest_b, 8);
+	}
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_journal_checksum:
+
+		Calculate checksum of journal record and its sector hashes.
+
+	---------------------------------------------------------------------------------------- */
+static void XORenc_journal_checksum(const TXORencJournal* record, const uint8_t* hashes, const size_t hashes_len, uint8_t* checksum) {
+
+	uint8_t*       data = malloc(sizeof(TXORencJournal) + hashes_len);
+	TXORencJournal copy = *record;
+	char           digest_s[32];
+
+	memset(checksum, 0xff, 16);
+
+	if (data == NULL) {
+		return;
+	}
+
+	memset(copy.checksum, 0, sizeof(copy.checksum));
+	memcpy(data, &copy, sizeof(copy));
+	memcpy(&data[sizeof(copy)], hashes, hashes_len);
+
+	XORenc_md5(data, sizeof(copy) + hashes_len, checksum, digest_s);
+
+	free(data);
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_encrypt_in_place:
+
+		En/de-crypt file in place, one block at a time, keeping a journal ('<file>.xenj')
+		of the block being rewritten. If a journal is found the interrupted run is recovered
+		and continued first (the same key must be given).
+
+	Parameters:
+
+		filename -> Path to file to be en/de-crypted.
+
+		key      -> Path to key file, byte sequence or password, according to 'params.key_type'.
+
+		params   -> The parameters to be considered.
+
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_encrypt_in_place(const char* filename, const char* key, const TXORencParams params) {
+
+	const size_t    SLOT_SIZE = sizeof(TXORencJournal) + ((XORENC_FILE_BLOCK_SIZE / XORENC_JOURNAL_SECTOR) * 8);
+	TXORencContext* ctx;
+	TXORencJournal  record, current;
+	TXORencStats*   stats      = params.stats;
+	char*           journal    = (filename != NULL) ? malloc(strlen(filename) + sizeof(".xenj")) : NULL;
+	uint8_t*        buf        = malloc(XORENC_FILE_BLOCK_SIZE);
+	uint8_t*        keystream  = malloc(XORENC_FILE_BLOCK_SIZE);
+	uint8_t*        hashes     = malloc(SLOT_SIZE * 2);
+	uint8_t         checksum[16], digest_b[16];
+	char            digest_s[32];
+	uint64_t        position   = 0;
+	uint64_t        sequence   = 0;
+	uint64_t        t_total    = XORenc_clock();
+	uint64_t        t0;
+	uint64_t        read_next  = 0; // see 'XORenc_throttle'
+	uint64_t        write_next = 0;
+	struct stat     file_stat;
+	int             fd0        = -1;
+	int             fd1        = -1;
+	int             r;
+	size_t          length, lpp0, lpp1;
+
+	/* ******* --- XORenc_encrypt_in_place --- ******* */
+
+	if ((filename == NULL) || (journal == NULL) || (buf == NULL) || (keystream == NULL) || (hashes == NULL)) {
+		free(journal);
+		free(buf);
+		free(keystream);
+		free(hashes);
+
+		return (filename == NULL) ? XORENC_ERROR_PARAMS : XORENC_ERROR_MEMORY;
+	}
+
+	sprintf(journal, "%s.xenj", filename);
+
+	r = XORenc_init(&ctx, key, params);
+
+	if (r >= 0) {
+		fd0 = open(filename, O_RDWR);
+		r   = ((fd0 < 0) || (fstat(fd0, &file_stat) != 0)) ? XORENC_ERROR_INPUT : r;
+	}
+
+	// a key running out halfway would leave the file half rewritten, with no way to recover it
+	if ((r >= 0) && (params.key_type == Direct) && (! params.cyclic_key) && (ctx->key_length < (uint64_t)file_stat.st_size)) {
+		r = XORENC_ERROR_KEY_TOO_SHORT;
+	}
+
+	if (r >= 0) {
+		fd1 = open(journal, O_RDWR | O_CREAT, 0600);
+		r   = (fd1 < 0) ? XORENC_ERROR_OUTPUT : r;
+	}
+	// *** FREE: ctx, fd0, fd1, journal, buf, keystream, hashes
+
+
+	// find newest valid record of an interrupted run
+	memset(&current, 0, sizeof(current));
+
+	for (lpp0=0; (r >= 0) && (lpp0 < 2); lpp0++) {
+		uint8_t* slot = &hashes[lpp0 * SLOT_SIZE];
+
+		if (pread(fd1, slot, SLOT_SIZE, lpp0 * SLOT_SIZE) < (ssize_t)sizeof(TXORencJournal)) {
+			continue;
+		}
+
+		memcpy(&record, slot, sizeof(record));
+
+		if ((memcmp(record.magic, "XENJRNL1", 8) != 0) || (record.length > XORENC_FILE_BLOCK_SIZE) || (record.sequence < current.sequence)) {
+			continue;
+		}
+
+		XORenc_journal_checksum(&record, &slot[sizeof(record)], SLOT_SIZE - sizeof(record), checksum);
+
+		if (memcmp(checksum, record.checksum, 16) == 0) {
+			current = record;
+
+			memcpy(hashes, slot, SLOT_SIZE);
+		}
+	}
+
+	// recover block being rewritten: every sector back to original data, then continue from it
+	if ((r >= 0) && (current.sequence > 0)) {
+		if (current.file_size != (uint64_t)file_stat.st_size) {
+			r = XORENC_ERROR_PARAMS;
+		}
+
+		explicit_bzero(keystream, current.length);
+
+		if (r >= 0) {
+			r = XORenc_seek(ctx, current.position);
+		}
+
+		if (r >= 0) {
+			r = XORenc_update(ctx, keystream, current.length);
+		}
+
+		XORenc_md5(keystream, current.length, digest_b, digest_s);
+
+		if ((r >= 0) && (memcmp(digest_b, current.key_check, 8) != 0)) {
+			r = XORENC_ERROR_KEY;
+		}
+
+		if ((r >= 0) && (pread(fd0, buf, current.length, current.position) != (ssize_t)current.length)) {
+			r = XORENC_ERROR_INPUT;
+		}
+
+		for (lpp0=0; (r >= 0) && (lpp0 < current.length); lpp0 += XORENC_JOURNAL_SECTOR) {
+			size_t  sector_len = ((current.length - lpp0) < XORENC_JOURNAL_SECTOR) ? (current.length - lpp0) : XORENC_JOURNAL_SECTOR;
+			uint8_t hash[8]    = { 0 };
+
+			XORenc_journal_hash(&buf[lpp0], sector_len, hash);
+
+			if (memcmp(hash, &hashes[sizeof(TXORencJournal) + ((lpp0 / XORENC_JOURNAL_SECTOR) * 8)], 8) == 0) {
+				// sector was not rewritten yet
+				continue;
+			}
+
+			for (lpp1=0; lpp1 < sector_len; lpp1++) {
+				buf[lpp0 + lpp1] ^= keystream[lpp0 + lpp1];
+			}
+
+			XORenc_journal_hash(&buf[lpp0], sector_len, hash);
+
+			if (memcmp(hash, &hashes[sizeof(TXORencJournal) + ((lpp0 / XORENC_JOURNAL_SECTOR) * 8)], 8) != 0) {
+				// neither original nor rewritten, can not be recovered
+				r = XORENC_ERROR_INPUT;
+			}
+		}
+
+		if ((r >= 0) && ((pwrite(fd0, buf, current.length, current.position) != (ssize_t)current.length) || (fdatasync(fd0) != 0))) {
+			r = XORENC_ERROR_OUTPUT;
+		}
+
+		position = current.position;
+		sequence = current.sequence;
+	}
+	else if (r >= 0) {
+		// journal must survive a crash before any block is rewritten
+		char* dir = strdup(filename);
+		int   fd2;
+
+		if ((dir != NULL) && (strrchr(dir, '/') != NULL)) {
+			*strrchr(dir, '/') = '\0';
+		}
+
+		fd2 = open(((dir != NULL) && (strchr(filename, '/') != NULL)) ? ((dir[0] != '\0') ? dir : "/") : ".", O_RDONLY);
+
+		if ((fd2 < 0) || (fsync(fd2) != 0)) {
+			r = XORENC_ERROR_OUTPUT;
+		}
+
+		if (fd2 >= 0) {
+			close(fd2);
+		}
+
+		free(dir);
+	}
+
+	if (r >= 0) {
+		r = XORenc_seek(ctx, position);
+	}
+	// *** FREE: ctx, fd0, fd1, journal, buf, keystream, hashes
+
+
+	// rewrite file block by block
+	for (; (r >= 0) && (position < (uint64_t)file_stat.st_size); position += length) {
+		length = ((file_stat.st_size - position) < XORENC_FILE_BLOCK_SIZE) ? (file_stat.st_size - position) : XORENC_FILE_BLOCK_SIZE;
+
+		XORenc_throttle(&read_next, params.bwlimit, length);
+
+		t0 = XORenc_stats_begin(&params, XORENC_STAGE_READ);
+
+		if (pread(fd0, buf, length, position) != (ssize_t)length) {
+			r = XORENC_ERROR_INPUT;
+
+			break;
+		}
+
+		XORenc_stats_end(&params, XORENC_STAGE_READ, t0);
+
+		// record of block (keystream is needed for its key check)
+		explicit_bzero(keystream, length);
+
+		r = XORenc_update(ctx, keystream, length);
+
+		if (r < 0) {
+			break;
+		}
+
+		sequence += 1;
+
+		memset(&record, 0, sizeof(record));
+		memcpy(record.magic, "XENJRNL1", 8);
+
+		record.sequence  = sequence;
+		record.position  = position;
+		record.length    = length;
+		record.file_size = file_stat.st_size;
+
+		XORenc_md5(keystream, length, digest_b, digest_s);
+		memcpy(record.key_check, digest_b, 8);
+
+		memset(&hashes[sizeof(record)], 0, SLOT_SIZE - sizeof(record));
+		XORenc_journal_hash(buf, length, &hashes[sizeof(record)]);
+		XORenc_journal_checksum(&record, &hashes[sizeof(record)], SLOT_SIZE - sizeof(record), record.checksum);
+		memcpy(hashes, &record, sizeof(record));
+
+		XORenc_throttle(&write_next, params.bwlimit, length + SLOT_SIZE);
+
+		t0 = XORenc_stats_begin(&params, XORENC_STAGE_WRITE);
+
+		if ((pwrite(fd1, hashes, SLOT_SIZE, (sequence % 2) * SLOT_SIZE) != (ssize_t)SLOT_SIZE) || (fdatasync(fd1) != 0)) {
+			r = XORENC_ERROR_OUTPUT;
+
+			break;
+		}
+
+		// only now the block may be overwritten
+		XORenc_encrypt_xor(buf, length, keystream, length);
+
+		if ((pwrite(fd0, buf, length, position) != (ssize_t)length) || (fdatasync(fd0) != 0)) {
+			r = XORENC_ERROR_OUTPUT;
+
+			break;
+		}
+
+		XORenc_stats_end(&params, XORENC_STAGE_WRITE, t0);
+
+		if (stats != NULL) {
+			stats->bytes_in  += length;
+			stats->bytes_out += length;
+			stats->blocks    += XORenc_blocks(position, length);
+		}
+	}
+
+	// whole file was rewritten, journal is not needed anymore
+	if (r >= 0) {
+		unlink(journal);
+	}
+
+
+	// free used resources
+	if (fd0 >= 0) {
+		close(fd0);
+	}
+
+	if (fd1 >= 0) {
+		close(fd1);
+	}
+
+	if (ctx != NULL) {
+		XORenc_final(ctx);
+	}
+
+	// keystream and blocks of data (original and rewritten)
+	explicit_bzero(keystream, XORENC_FILE_BLOCK_SIZE);
+	explicit_bzero(buf, XORENC_FILE_BLOCK_SIZE);
+
+	free(journal);
+	free(buf);
+	free(keystream);
+	free(hashes);
+
+	if (stats != NULL) {
+		stats->total_ns += XORenc_clock() - t_total;
+	}
+
+	return r;
+}
+
+/** ----------------------------------------------------------------------------------------
+
+	XORenc_process_file:
+
+		Process input file according to given parameters.
+
+	Parameters:
+
+		filename -> Path to file to be encrypted. Must be NULL if input is to be read from standard input (stdin).
+
+		key      -> Corresponds to key in one of the three available formats: path to file, byte sequence, or common string.
+        
+		std_out  -> Output file to standard output (stdout)?
+        
+		params   -> The parameters to be considered.
+        
+	Return value:
+
+		Returns positive value or 0 if successful.
+
+	---------------------------------------------------------------------------------------- */
+int XORenc_process_file(const char* filename, const char* key, const bool std_out, const TXORencParams params) {
+
+	if (params.key_type == Derived) {
+		// key is a common password
+		return XORenc_encrypt(filename, NULL, key, params, std_out);
+	}
+	else {
+		// key is path to key file or a sequence of bytes as string, in the form: 'XX XX XX...'
+		return XORenc_encrypt(filename, key, NULL, params, std_out);
 	}
-	
-	
-	return r;
 }